@@ -0,0 +1,219 @@
+#include "autocomplete.h"
+#include "books.h"
+#include "search_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct entry {
+    char *key; // lower-cased, owned
+    struct autocomplete_hit hit;
+};
+
+struct node {
+    uint32_t child;  // first child in nodes
+    uint32_t top;    // first of the node's best entries in tops
+    uint16_t nchild;
+    uint8_t ntop;
+    uint8_t label;   // byte leading here from the parent
+};
+
+struct trie {
+    struct entry *entries; // sorted by key
+    uint32_t nentries;
+    struct node *nodes;    // root first
+    uint32_t nnodes;
+    uint32_t *tops;        // entry indexes, best first per node
+    size_t ntops;
+};
+
+static struct trie words, books;
+
+static char *lower_dup(const char *s) {
+    size_t n = strlen(s);
+    char *d = malloc(n + 1);
+    if (!d) return NULL;
+    for (size_t i = 0; i <= n; ++i)
+        d[i] = (char)(s[i] >= 'A' && s[i] <= 'Z' ? s[i] + 32 : s[i]);
+    return d;
+}
+
+static int by_key(const void *a, const void *b) {
+    return strcmp(((const struct entry *)a)->key, ((const struct entry *)b)->key);
+}
+
+static void trie_free(struct trie *t) {
+    for (uint32_t i = 0; i < t->nentries; ++i) free(t->entries[i].key);
+    free(t->entries);
+    free(t->nodes);
+    free(t->tops);
+    memset(t, 0, sizeof(*t));
+}
+
+// True if entry a ranks before entry b.
+static bool better(const struct trie *t, uint32_t a, uint32_t b) {
+    const struct autocomplete_hit *x = &t->entries[a].hit, *y = &t->entries[b].hit;
+    return x->weight > y->weight || (x->weight == y->weight && a < b);
+}
+
+// Node under construction: its entries are [lo, hi), sharing depth bytes.
+struct pending {
+    uint32_t lo, hi, depth;
+};
+
+// Lays the trie out over the sorted entries breadth first. Returns 0 or -1.
+static int trie_build(struct trie *t) {
+    struct pending *queue = NULL;
+    size_t cap_nodes = 0, cap_tops = 0;
+    uint32_t head = 0;
+
+    qsort(t->entries, t->nentries, sizeof(*t->entries), by_key);
+    // Every node is one prefix of one key, so the key bytes bound them.
+    for (uint32_t i = 0; i < t->nentries; ++i) cap_nodes += strlen(t->entries[i].key);
+    cap_nodes++;
+    if ((t->nodes = calloc(cap_nodes, sizeof(*t->nodes))) == NULL ||
+        (queue = malloc(cap_nodes * sizeof(*queue))) == NULL)
+        goto oom;
+    t->nnodes = 1;
+    queue[0] = (struct pending){0, t->nentries, 0};
+
+    for (; head < t->nnodes; ++head) {
+        struct pending p = queue[head];
+        struct node *n = &t->nodes[head];
+        uint32_t best[AUTOCOMPLETE_MAX], nbest = 0;
+
+        // Keep the best entries of the subtree by insertion.
+        for (uint32_t e = p.lo; e < p.hi; ++e) {
+            uint32_t i = nbest < AUTOCOMPLETE_MAX ? nbest++ : AUTOCOMPLETE_MAX;
+            if (i == AUTOCOMPLETE_MAX && !better(t, e, best[--i])) continue;
+            for (; i > 0 && better(t, e, best[i - 1]); --i) best[i] = best[i - 1];
+            best[i] = e;
+        }
+        if (t->ntops + nbest > cap_tops) {
+            size_t cap = cap_tops ? cap_tops * 2 : 4096;
+            uint32_t *q = realloc(t->tops, cap * sizeof(*q));
+            if (!q) goto oom;
+            t->tops = q;
+            cap_tops = cap;
+        }
+        n->top = (uint32_t)t->ntops;
+        n->ntop = (uint8_t)nbest;
+        memcpy(t->tops + t->ntops, best, nbest * sizeof(*best));
+        t->ntops += nbest;
+
+        // Sorted keys put the one ending here first and group the rest by
+        // their next byte.
+        uint32_t e = p.lo;
+        if (e < p.hi && t->entries[e].key[p.depth] == '\0') e++;
+        n->child = t->nnodes;
+        while (e < p.hi) {
+            unsigned char ch = (unsigned char)t->entries[e].key[p.depth];
+            uint32_t end = e;
+            while (end < p.hi && (unsigned char)t->entries[end].key[p.depth] == ch) end++;
+            t->nodes[t->nnodes].label = ch;
+            queue[t->nnodes++] = (struct pending){e, end, p.depth + 1};
+            n->nchild++;
+            e = end;
+        }
+    }
+    free(queue);
+    return 0;
+
+oom:
+    free(queue);
+    return -1;
+}
+
+static const struct node *trie_find(const struct trie *t, const char *prefix) {
+    const struct node *n = t->nodes;
+    if (!n) return NULL;
+    for (const unsigned char *p = (const unsigned char *)prefix; *p; ++p) {
+        unsigned char ch = *p >= 'A' && *p <= 'Z' ? *p + 32 : *p;
+        uint32_t lo = n->child, hi = n->child + n->nchild;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (t->nodes[mid].label < ch) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == n->child + n->nchild || t->nodes[lo].label != ch) return NULL;
+        n = &t->nodes[lo];
+    }
+    return n;
+}
+
+static size_t trie_complete(const struct trie *t, const char *prefix,
+                            struct autocomplete_hit *out, size_t max) {
+    const struct node *n = trie_find(t, prefix);
+    size_t k = 0;
+    for (; n && k < n->ntop && k < max; ++k) out[k] = t->entries[t->tops[n->top + k]].hit;
+    return k;
+}
+
+struct collect {
+    struct trie *t;
+    uint32_t cap;
+    bool failed;
+};
+
+static void add_word(const char *term, uint32_t count, void *arg) {
+    struct collect *c = arg;
+    struct trie *t = c->t;
+    if (c->failed) return;
+    if (t->nentries == c->cap) {
+        uint32_t cap = c->cap ? c->cap * 2 : 4096;
+        struct entry *p = realloc(t->entries, cap * sizeof(*p));
+        if (!p) {
+            c->failed = true;
+            return;
+        }
+        t->entries = p;
+        c->cap = cap;
+    }
+    // Index terms are already lower case.
+    struct entry *e = &t->entries[t->nentries];
+    if ((e->key = strdup(term)) == NULL) {
+        c->failed = true;
+        return;
+    }
+    e->hit = (struct autocomplete_hit){e->key, 0, count};
+    t->nentries++;
+}
+
+int autocomplete_build(const struct corpus *cp) {
+    struct collect c = {&words, 0, false};
+
+    autocomplete_free();
+    search_index_each_term(add_word, &c);
+    if (c.failed || trie_build(&words) != 0) goto oom;
+
+    if ((books.entries = calloc(BOOK_COUNT, sizeof(*books.entries))) == NULL) goto oom;
+    for (int b = 1; b <= BOOK_COUNT; ++b) {
+        struct entry *e = &books.entries[books.nentries];
+        uint32_t verses = 0;
+        if ((uint32_t)b <= cp->nbooks) {
+            uint32_t c0 = cp->book_chapter[b], c1 = cp->book_chapter[b + 1];
+            verses = cp->chapter_verse[c1] - cp->chapter_verse[c0];
+        }
+        if ((e->key = lower_dup(book_names[b])) == NULL) goto oom;
+        e->hit = (struct autocomplete_hit){book_names[b], (uint32_t)b, verses};
+        books.nentries++;
+    }
+    if (trie_build(&books) != 0) goto oom;
+    return 0;
+
+oom:
+    autocomplete_free();
+    return -1;
+}
+
+void autocomplete_free(void) {
+    trie_free(&words);
+    trie_free(&books);
+}
+
+size_t autocomplete_words(const char *prefix, struct autocomplete_hit *out, size_t max) {
+    return trie_complete(&words, prefix, out, max);
+}
+
+size_t autocomplete_books(const char *prefix, struct autocomplete_hit *out, size_t max) {
+    return trie_complete(&books, prefix, out, max);
+}
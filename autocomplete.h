@@ -0,0 +1,30 @@
+#ifndef AUTOCOMPLETE_H
+#define AUTOCOMPLETE_H
+#include <stddef.h>
+#include <stdint.h>
+#include "corpus.h"
+
+// Prefix completion over the vocabulary of the search index and the book
+// names. Each kind is a trie laid out breadth first, so a node's children
+// are consecutive and sorted by byte, and every node keeps the indexes of
+// its AUTOCOMPLETE_MAX most frequent completions. A lookup walks the
+// prefix and copies that list; it never allocates. Keys are folded to
+// lower case. Read-only once built and safe to query from any thread.
+#define AUTOCOMPLETE_MAX 16
+
+struct autocomplete_hit {
+    const char *text; // the word, or the book name as printed
+    uint32_t id;      // book number, 0 for words
+    uint32_t weight;  // occurrences of the word, or verses of the book
+};
+
+// Builds both tries from the search index and cp. Returns 0 on success,
+// -1 on allocation failure.
+int autocomplete_build(const struct corpus *cp);
+void autocomplete_free(void);
+
+// Store up to max completions of prefix, most frequent first, in out and
+// return how many there are.
+size_t autocomplete_words(const char *prefix, struct autocomplete_hit *out, size_t max);
+size_t autocomplete_books(const char *prefix, struct autocomplete_hit *out, size_t max);
+#endif // AUTOCOMPLETE_H
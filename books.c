@@ -0,0 +1,48 @@
+#include "books.h"
+#include "books_hash.h"
+#include <string.h>
+
+const char *const book_names[BOOK_COUNT + 1] = {
+    NULL,
+    "Genesis", "Exodus", "Leviticus", "Numbers", "Deuteronomy", "Joshua",
+    "Judges", "Ruth", "1 Samuel", "2 Samuel", "1 Kings", "2 Kings",
+    "1 Chronicles", "2 Chronicles", "Ezra", "Nehemiah", "Esther", "Job",
+    "Psalms", "Proverbs", "Ecclesiastes", "Song of Solomon", "Isaiah",
+    "Jeremiah", "Lamentations", "Ezekiel", "Daniel", "Hosea", "Joel", "Amos",
+    "Obadiah", "Jonah", "Micah", "Nahum", "Habakkuk", "Zephaniah", "Haggai",
+    "Zechariah", "Malachi",
+    "Matthew", "Mark", "Luke", "John", "Acts", "Romans", "1 Corinthians",
+    "2 Corinthians", "Galatians", "Ephesians", "Philippians", "Colossians",
+    "1 Thessalonians", "2 Thessalonians", "1 Timothy", "2 Timothy", "Titus",
+    "Philemon", "Hebrews", "James", "1 Peter", "2 Peter", "1 John", "2 John",
+    "3 John", "Jude", "Revelation",
+};
+
+const char *book_name(int n) {
+    return n >= 1 && n <= BOOK_COUNT ? book_names[n] : NULL;
+}
+
+int book_lookup(const char *name, size_t len) {
+    char key[sizeof(book_hash_slots[0].key)];
+    size_t n = 0, i = 0;
+
+    // I, II and III followed by a space or a period are book numbers.
+    while (i < len && i < 3 && (name[i] == 'I' || name[i] == 'i')) i++;
+    if (i > 0 && i < len && (name[i] == ' ' || name[i] == '.')) key[n++] = (char)('0' + i);
+    else i = 0;
+    for (; i < len; ++i) {
+        unsigned char ch = (unsigned char)name[i];
+        if (ch == ' ' || ch == '.') continue;
+        if (ch >= 'A' && ch <= 'Z') ch += 'a' - 'A';
+        if (!((ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9'))) return 0;
+        if (n == sizeof(key) - 1) return 0;
+        key[n++] = (char)ch;
+    }
+    if (n == 0) return 0;
+
+    uint32_t d = book_hash_disp[book_hash(0, key, n) & (BOOK_HASH_BUCKETS - 1)];
+    uint32_t s = book_hash(d, key, n) & (BOOK_HASH_SLOTS - 1);
+    if (memcmp(book_hash_slots[s].key, key, n) != 0 || book_hash_slots[s].key[n] != '\0')
+        return 0;
+    return book_hash_slots[s].book;
+}
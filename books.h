@@ -0,0 +1,30 @@
+#ifndef BOOKS_H
+#define BOOKS_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Books of the KJV canon in corpus order: book n of the kjv table is
+// book_names[n], Genesis being 1 and Revelation BOOK_COUNT.
+#define BOOK_COUNT 66
+
+extern const char *const book_names[BOOK_COUNT + 1];
+
+// Returns the name of book n, or NULL if there is no such book.
+const char *book_name(int n);
+
+// Returns the book named by name[0, len), or 0 if none is. Full names and
+// common abbreviations are accepted, in any case, with or without spaces
+// and periods; a leading I, II or III stands for 1, 2 or 3.
+int book_lookup(const char *name, size_t len);
+
+// FNV-1a, seeded. Shared with tools/mkbookhash.c, which builds the perfect
+// hash table book_lookup probes.
+static inline uint32_t book_hash(uint32_t seed, const char *s, size_t n) {
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+#endif // BOOKS_H
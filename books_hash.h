@@ -0,0 +1,271 @@
+// Generated by tools/mkbookhash.c from its alias table; do not edit.
+// 250 keys. A key's slot is book_hash(disp, key) & (BOOK_HASH_SLOTS - 1),
+// where disp is book_hash_disp[book_hash(0, key) & (BOOK_HASH_BUCKETS - 1)].
+#define BOOK_HASH_BUCKETS 64
+#define BOOK_HASH_SLOTS 512
+
+static const uint16_t book_hash_disp[BOOK_HASH_BUCKETS] = {
+    0, 2, 2, 2, 7, 2, 2, 1, 2, 3,
+    13, 2, 2, 2, 4, 6, 2, 4, 4, 2,
+    1, 1, 11, 1, 2, 1, 8, 3, 3, 1,
+    7, 3, 3, 13, 10, 5, 1, 6, 4, 1,
+    3, 1, 6, 8, 6, 2, 2, 9, 7, 4,
+    5, 5, 12, 6, 0, 2, 1, 7, 1, 11,
+    1, 4, 1, 3,
+};
+
+static const struct {
+    char key[16];
+    uint8_t book;
+} book_hash_slots[BOOK_HASH_SLOTS] = {
+    [0] = {"es", 17},
+    [3] = {"james", 59},
+    [5] = {"zechariah", 38},
+    [8] = {"titus", 56},
+    [10] = {"3joh", 64},
+    [11] = {"2th", 53},
+    [14] = {"rom", 45},
+    [15] = {"jm", 59},
+    [16] = {"1john", 62},
+    [17] = {"dan", 27},
+    [18] = {"2thess", 53},
+    [19] = {"acts", 44},
+    [20] = {"1timothy", 54},
+    [21] = {"romans", 45},
+    [22] = {"matthew", 40},
+    [23] = {"dt", 5},
+    [25] = {"mrk", 41},
+    [26] = {"1kings", 11},
+    [27] = {"ezr", 15},
+    [28] = {"esth", 17},
+    [30] = {"phlm", 57},
+    [31] = {"2kgs", 12},
+    [32] = {"mk", 41},
+    [34] = {"revelations", 66},
+    [35] = {"3john", 64},
+    [36] = {"malachi", 39},
+    [38] = {"galatians", 48},
+    [39] = {"zep", 36},
+    [41] = {"jnh", 32},
+    [42] = {"ezek", 26},
+    [43] = {"leviticus", 3},
+    [46] = {"gen", 1},
+    [47] = {"john", 43},
+    [50] = {"numbers", 4},
+    [54] = {"rev", 66},
+    [55] = {"ga", 48},
+    [59] = {"philem", 57},
+    [60] = {"de", 5},
+    [62] = {"re", 66},
+    [63] = {"hos", 28},
+    [68] = {"jhn", 43},
+    [71] = {"mc", 33},
+    [75] = {"rth", 8},
+    [80] = {"1jo", 62},
+    [81] = {"exod", 2},
+    [82] = {"1co", 46},
+    [84] = {"ac", 44},
+    [88] = {"2samuel", 10},
+    [90] = {"ex", 2},
+    [91] = {"jdgs", 7},
+    [96] = {"num", 4},
+    [101] = {"col", 51},
+    [103] = {"1pet", 60},
+    [106] = {"pr", 20},
+    [108] = {"daniel", 27},
+    [111] = {"jb", 18},
+    [112] = {"1ki", 11},
+    [113] = {"isa", 23},
+    [115] = {"2ch", 14},
+    [116] = {"2ki", 12},
+    [120] = {"2ti", 55},
+    [122] = {"revelation", 66},
+    [123] = {"ti", 56},
+    [124] = {"2thessalonians", 53},
+    [129] = {"ruth", 8},
+    [130] = {"hag", 37},
+    [131] = {"matt", 40},
+    [133] = {"1samuel", 9},
+    [135] = {"luke", 42},
+    [137] = {"nm", 4},
+    [138] = {"genesis", 1},
+    [139] = {"ru", 8},
+    [140] = {"1k", 11},
+    [142] = {"2s", 10},
+    [143] = {"amos", 30},
+    [144] = {"jg", 7},
+    [146] = {"jeremiah", 24},
+    [147] = {"gal", 48},
+    [148] = {"2co", 47},
+    [149] = {"1jn", 62},
+    [150] = {"exodus", 2},
+    [152] = {"jonah", 32},
+    [153] = {"1s", 9},
+    [156] = {"est", 17},
+    [158] = {"eph", 49},
+    [159] = {"2timothy", 55},
+    [160] = {"jud", 65},
+    [169] = {"job", 18},
+    [170] = {"2sam", 10},
+    [175] = {"judges", 7},
+    [178] = {"proverbs", 20},
+    [180] = {"nb", 4},
+    [182] = {"ezk", 26},
+    [184] = {"2pe", 61},
+    [189] = {"cant", 22},
+    [191] = {"na", 34},
+    [195] = {"heb", 58},
+    [202] = {"jer", 24},
+    [205] = {"obad", 31},
+    [206] = {"ss", 22},
+    [207] = {"zc", 38},
+    [208] = {"1thes", 52},
+    [209] = {"la", 25},
+    [210] = {"psm", 19},
+    [215] = {"1chron", 13},
+    [217] = {"1cor", 46},
+    [221] = {"hosea", 28},
+    [222] = {"zp", 36},
+    [224] = {"jd", 65},
+    [225] = {"1peter", 60},
+    [226] = {"1chr", 13},
+    [227] = {"3jhn", 64},
+    [229] = {"deut", 5},
+    [230] = {"deuteronomy", 5},
+    [231] = {"1joh", 62},
+    [232] = {"haggai", 37},
+    [236] = {"psa", 19},
+    [237] = {"mt", 40},
+    [238] = {"hg", 37},
+    [243] = {"zech", 38},
+    [246] = {"2tim", 55},
+    [249] = {"1thessalonians", 52},
+    [251] = {"1p", 60},
+    [252] = {"habakkuk", 35},
+    [253] = {"1th", 52},
+    [254] = {"zec", 38},
+    [256] = {"lam", 25},
+    [258] = {"2jo", 63},
+    [259] = {"lev", 3},
+    [260] = {"2p", 61},
+    [261] = {"eze", 26},
+    [264] = {"esther", 17},
+    [265] = {"ephesians", 49},
+    [266] = {"lv", 3},
+    [272] = {"1tim", 54},
+    [277] = {"lamentations", 25},
+    [278] = {"philemon", 57},
+    [283] = {"2thes", 53},
+    [284] = {"rv", 66},
+    [285] = {"2pt", 61},
+    [289] = {"ne", 16},
+    [291] = {"rm", 45},
+    [292] = {"2pet", 61},
+    [293] = {"ml", 39},
+    [294] = {"2john", 63},
+    [295] = {"2corinthians", 47},
+    [300] = {"isaiah", 23},
+    [301] = {"am", 30},
+    [302] = {"2jhn", 63},
+    [308] = {"prov", 20},
+    [310] = {"mal", 39},
+    [313] = {"phil", 50},
+    [314] = {"micah", 33},
+    [316] = {"2peter", 61},
+    [319] = {"1thess", 52},
+    [322] = {"eccl", 21},
+    [323] = {"songofsongs", 22},
+    [324] = {"1sam", 9},
+    [325] = {"2chronicles", 14},
+    [328] = {"jr", 24},
+    [330] = {"pm", 57},
+    [338] = {"ro", 45},
+    [340] = {"2sa", 10},
+    [343] = {"jas", 59},
+    [345] = {"1sm", 9},
+    [346] = {"nu", 4},
+    [347] = {"1chronicles", 13},
+    [348] = {"1kgs", 11},
+    [350] = {"1ch", 13},
+    [351] = {"ho", 28},
+    [352] = {"jdg", 7},
+    [354] = {"joh", 43},
+    [356] = {"1pe", 60},
+    [358] = {"1pt", 60},
+    [361] = {"ezekiel", 26},
+    [364] = {"ecclesiastes", 21},
+    [365] = {"da", 27},
+    [367] = {"1sa", 9},
+    [369] = {"1ti", 54},
+    [370] = {"2k", 12},
+    [371] = {"3jo", 64},
+    [375] = {"2kin", 12},
+    [376] = {"1kin", 11},
+    [377] = {"2kings", 12},
+    [378] = {"1jhn", 62},
+    [379] = {"mr", 41},
+    [380] = {"3jn", 64},
+    [382] = {"pro", 20},
+    [383] = {"philippians", 50},
+    [386] = {"nah", 34},
+    [387] = {"2joh", 63},
+    [388] = {"judg", 7},
+    [390] = {"ezra", 15},
+    [391] = {"pss", 19},
+    [394] = {"dn", 27},
+    [396] = {"jsh", 6},
+    [397] = {"jon", 32},
+    [399] = {"colossians", 51},
+    [400] = {"ob", 31},
+    [401] = {"mat", 40},
+    [403] = {"2chr", 14},
+    [404] = {"ecc", 21},
+    [405] = {"songofsolomon", 22},
+    [407] = {"nahum", 34},
+    [409] = {"jude", 65},
+    [413] = {"tit", 56},
+    [419] = {"phm", 57},
+    [420] = {"qoh", 21},
+    [422] = {"nehemiah", 16},
+    [425] = {"prv", 20},
+    [428] = {"is", 23},
+    [430] = {"obadiah", 31},
+    [431] = {"lk", 42},
+    [434] = {"canticles", 22},
+    [435] = {"zephaniah", 36},
+    [436] = {"ge", 1},
+    [438] = {"je", 24},
+    [439] = {"mark", 41},
+    [442] = {"sos", 22},
+    [443] = {"2sm", 10},
+    [444] = {"2cor", 47},
+    [447] = {"josh", 6},
+    [452] = {"psalms", 19},
+    [453] = {"song", 22},
+    [455] = {"eccles", 21},
+    [456] = {"le", 3},
+    [457] = {"hab", 35},
+    [458] = {"hb", 35},
+    [460] = {"jn", 43},
+    [461] = {"mar", 41},
+    [466] = {"joshua", 6},
+    [469] = {"gn", 1},
+    [471] = {"zeph", 36},
+    [472] = {"luk", 42},
+    [475] = {"2chron", 14},
+    [479] = {"psalm", 19},
+    [480] = {"2jn", 63},
+    [481] = {"jl", 29},
+    [483] = {"exo", 2},
+    [486] = {"jos", 6},
+    [490] = {"ephes", 49},
+    [491] = {"neh", 16},
+    [492] = {"php", 50},
+    [493] = {"hebrews", 58},
+    [496] = {"joel", 29},
+    [497] = {"mic", 33},
+    [498] = {"ec", 21},
+    [501] = {"act", 44},
+    [504] = {"1corinthians", 46},
+    [509] = {"ps", 19},
+};
@@ -0,0 +1,79 @@
+#include "chapter_cache.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+struct slot {
+    struct rbuf *body;
+    int referenced;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct slot *slots;
+static uint32_t nslots, hand;
+static struct chapter_cache_stats stats;
+
+int chapter_cache_init(uint32_t nchapters, size_t max_bytes) {
+    chapter_cache_free();
+    if ((slots = calloc(nchapters, sizeof(*slots))) == NULL) return -1;
+    nslots = nchapters;
+    stats.capacity = max_bytes;
+    return 0;
+}
+
+void chapter_cache_free(void) {
+    for (uint32_t i = 0; i < nslots; ++i) rbuf_unref(slots[i].body);
+    free(slots);
+    slots = NULL;
+    nslots = hand = 0;
+    stats = (struct chapter_cache_stats){0};
+}
+
+struct rbuf *chapter_cache_get(uint32_t ci) {
+    struct rbuf *b = NULL;
+    pthread_mutex_lock(&lock);
+    if (ci < nslots && slots[ci].body) {
+        stats.hits++;
+        slots[ci].referenced = 1;
+        b = rbuf_ref(slots[ci].body);
+    } else {
+        stats.misses++;
+    }
+    pthread_mutex_unlock(&lock);
+    return b;
+}
+
+static void evict(struct slot *s) {
+    stats.bytes -= rbuf_size(s->body);
+    stats.entries--;
+    stats.evictions++;
+    rbuf_unref(s->body);
+    s->body = NULL;
+}
+
+int chapter_cache_put(uint32_t ci, struct rbuf *body) {
+    int rc = -1;
+    pthread_mutex_lock(&lock);
+    if (ci >= nslots || rbuf_size(body) > stats.capacity || slots[ci].body) goto done;
+    // Sweep the clock, giving referenced slots a second chance.
+    while (stats.bytes + rbuf_size(body) > stats.capacity) {
+        struct slot *s = &slots[hand];
+        hand = (hand + 1) % nslots;
+        if (!s->body) continue;
+        if (s->referenced) s->referenced = 0;
+        else evict(s);
+    }
+    slots[ci].body = rbuf_ref(body);
+    slots[ci].referenced = 0;
+    stats.bytes += rbuf_size(body);
+    stats.entries++;
+    rc = 0;
+done:
+    pthread_mutex_unlock(&lock);
+    return rc;
+}
+
+void chapter_cache_get_stats(struct chapter_cache_stats *out) {
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
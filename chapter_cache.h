@@ -0,0 +1,29 @@
+#ifndef CHAPTER_CACHE_H
+#define CHAPTER_CACHE_H
+#include <stddef.h>
+#include <stdint.h>
+#include "rbuf.h"
+
+// Byte-bounded cache of rendered get_chapter bodies, one slot per chapter
+// index of the corpus. Eviction is CLOCK (second chance) over the slots.
+// All functions are safe to call from any event loop thread.
+struct chapter_cache_stats {
+    unsigned long hits, misses, evictions;
+    size_t entries, bytes, capacity;
+};
+
+// Sizes the cache for nchapters slots holding at most max_bytes of bodies.
+// Returns 0 on success, -1 on allocation failure.
+int chapter_cache_init(uint32_t nchapters, size_t max_bytes);
+void chapter_cache_free(void);
+
+// Returns a new reference to the cached body for chapter index ci, or NULL
+// on a miss. Release it with rbuf_unref.
+struct rbuf *chapter_cache_get(uint32_t ci);
+
+// Stores body for ci, taking a reference of its own. Returns -1 if ci is
+// already cached or the body is larger than the whole cache.
+int chapter_cache_put(uint32_t ci, struct rbuf *body);
+
+void chapter_cache_get_stats(struct chapter_cache_stats *out);
+#endif // CHAPTER_CACHE_H
@@ -0,0 +1,184 @@
+#include "compress.h"
+#include <stdlib.h>
+#include <zlib.h>
+
+// A gzip member written by zlib without optional fields: a 10 byte header
+// and a trailer of CRC-32 and length, around the raw deflate stream.
+#define GZIP_HEAD 10
+#define GZIP_TAIL 8
+
+static struct compress_stats stats; // updated atomically
+
+// Returns the q-value of a coding's parameters in thousandths. A q-value
+// is "0" or "1" with up to three decimals, none above 1 (RFC 9110 12.4.2);
+// any other value counts as 0, so a malformed weight never selects a
+// coding.
+static int qvalue(struct mg_str params) {
+    struct mg_str p, rest = params;
+    while (mg_span(rest, &p, &rest, ';')) {
+        while (p.len > 0 && (p.buf[0] == ' ' || p.buf[0] == '\t')) p.buf++, p.len--;
+        while (p.len > 0 && (p.buf[p.len - 1] == ' ' || p.buf[p.len - 1] == '\t')) p.len--;
+        if (p.len < 2 || (p.buf[0] != 'q' && p.buf[0] != 'Q') || p.buf[1] != '=') continue;
+        const char *v = p.buf + 2;
+        size_t n = p.len - 2, i;
+        if (n == 0 || (v[0] != '0' && v[0] != '1')) return 0;
+        int q = (v[0] - '0') * 1000, scale = 100;
+        if (n > 1 && (v[1] != '.' || n > 5)) return 0;
+        for (i = 2; i < n; ++i, scale /= 10) {
+            if (v[i] < '0' || v[i] > '9') return 0;
+            q += (v[i] - '0') * scale;
+        }
+        return q > 1000 ? 0 : q;
+    }
+    return 1000;
+}
+
+enum encoding compress_negotiate(struct mg_http_message *hm) {
+    struct mg_str *ae = mg_http_get_header(hm, "Accept-Encoding");
+    struct mg_str item, list;
+    int gzip = -1, deflate = -1, any = -1;
+
+    if (ae == NULL) return ENC_IDENTITY;
+    list = *ae;
+    while (mg_span(list, &item, &list, ',')) {
+        struct mg_str coding, params;
+        mg_span(item, &coding, &params, ';');
+        while (coding.len > 0 && coding.buf[0] == ' ') coding.buf++, coding.len--;
+        while (coding.len > 0 && coding.buf[coding.len - 1] == ' ') coding.len--;
+        int q = qvalue(params);
+        if (mg_strcasecmp(coding, mg_str("gzip")) == 0 ||
+            mg_strcasecmp(coding, mg_str("x-gzip")) == 0)
+            gzip = q;
+        else if (mg_strcasecmp(coding, mg_str("deflate")) == 0)
+            deflate = q;
+        else if (mg_strcmp(coding, mg_str("*")) == 0)
+            any = q;
+    }
+    // Codings not listed take the q-value of "*", if any.
+    if (gzip < 0) gzip = any;
+    if (deflate < 0) deflate = any;
+    if (gzip > 0 && gzip >= deflate) return ENC_GZIP;
+    if (deflate > 0) return ENC_DEFLATE;
+    return ENC_IDENTITY;
+}
+
+int compress_body(struct rbuf *b) {
+    z_stream z;
+    char *out;
+    uLong bound;
+
+    if (b->gzip || b->len < COMPRESS_MIN_BYTES) return 0;
+    memset(&z, 0, sizeof(z));
+    // windowBits 15 + 16 asks for a gzip member instead of zlib framing.
+    if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        return -1;
+    bound = deflateBound(&z, (uLong)b->len);
+    if ((out = malloc(bound + 1)) == NULL) {
+        deflateEnd(&z);
+        return -1;
+    }
+    z.next_in = (Bytef *)b->data;
+    z.avail_in = (uInt)b->len;
+    z.next_out = (Bytef *)out;
+    z.avail_out = (uInt)bound;
+    int rc = deflate(&z, Z_FINISH);
+    size_t len = bound - z.avail_out;
+    deflateEnd(&z);
+    if (rc != Z_STREAM_END || len >= b->len) {
+        free(out);
+        return rc == Z_STREAM_END ? 0 : -1;
+    }
+    out[len] = '\0';
+    if ((b->gzip = rbuf_wrap(out, len)) == NULL) {
+        free(out);
+        return -1;
+    }
+    b->adler = (uint32_t)adler32(adler32(0, NULL, 0), (const Bytef *)b->data, (uInt)b->len);
+    __atomic_fetch_add(&stats.bodies, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats.bytes_in, b->len, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats.bytes_out, len, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static void put_le32(char *p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (char)(v >> (8 * i));
+}
+
+static uint32_t get_le32(const char *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; --i) v = v << 8 | (unsigned char)p[i];
+    return v;
+}
+
+// Writes the header of a stored, non-final deflate block of n bytes.
+static size_t stored_block(char *p, size_t n) {
+    p[0] = 0;
+    p[1] = (char)n, p[2] = (char)(n >> 8);
+    p[3] = (char)~n, p[4] = (char)(~n >> 8);
+    return 5;
+}
+
+int compress_parts(const struct rbuf *b, enum encoding enc, const char *head,
+                   size_t hlen, char frame[COMPRESS_FRAME], struct mg_str parts[4]) {
+    const struct rbuf *gz = b->gzip;
+    struct mg_str raw;
+    size_t n = 0;
+    int np = 0;
+
+    if (enc == ENC_IDENTITY) {
+        if (hlen > 0) parts[np++] = mg_str_n(head, hlen);
+        parts[np++] = mg_str_n(b->data, b->len);
+        return np;
+    }
+    raw = mg_str_n(gz->data + GZIP_HEAD, gz->len - GZIP_HEAD - GZIP_TAIL);
+    if (enc == ENC_GZIP) {
+        __atomic_fetch_add(&stats.gzip, 1, __ATOMIC_RELAXED);
+        if (hlen == 0) {
+            parts[0] = mg_str_n(gz->data, gz->len);
+            return 1;
+        }
+        // The member's header, head, its deflate stream, then the CRC-32
+        // and length of head and b together.
+        memcpy(frame, gz->data, GZIP_HEAD);
+        n = GZIP_HEAD + stored_block(frame + GZIP_HEAD, hlen);
+        uLong crc = crc32(crc32(0, NULL, 0), (const Bytef *)head, (uInt)hlen);
+        crc = crc32_combine(crc, get_le32(gz->data + gz->len - GZIP_TAIL), (z_off_t)b->len);
+        put_le32(frame + n, (uint32_t)crc);
+        put_le32(frame + n + 4, (uint32_t)(hlen + b->len));
+        parts[np++] = mg_str_n(frame, n);
+        parts[np++] = mg_str_n(head, hlen);
+        parts[np++] = raw;
+        parts[np++] = mg_str_n(frame + n, 8);
+        return np;
+    }
+    // zlib header for the default level, head, the same deflate stream,
+    // then the Adler-32 of head and b together, big-endian.
+    __atomic_fetch_add(&stats.deflate, 1, __ATOMIC_RELAXED);
+    uLong adler = b->adler;
+    frame[n++] = 0x78;
+    frame[n++] = (char)0x9c;
+    if (hlen > 0) {
+        n += stored_block(frame + n, hlen);
+        adler = adler32_combine(adler32(adler32(0, NULL, 0), (const Bytef *)head, (uInt)hlen),
+                                adler, (z_off_t)b->len);
+    }
+    for (int i = 0; i < 4; ++i) frame[n + i] = (char)(adler >> (24 - 8 * i));
+    parts[np++] = mg_str_n(frame, n);
+    if (hlen > 0) parts[np++] = mg_str_n(head, hlen);
+    parts[np++] = raw;
+    parts[np++] = mg_str_n(frame + n, 4);
+    return np;
+}
+
+const char *compress_name(enum encoding enc) {
+    return enc == ENC_GZIP ? "gzip" : enc == ENC_DEFLATE ? "deflate" : "identity";
+}
+
+void compress_get_stats(struct compress_stats *out) {
+    out->bodies = __atomic_load_n(&stats.bodies, __ATOMIC_RELAXED);
+    out->bytes_in = __atomic_load_n(&stats.bytes_in, __ATOMIC_RELAXED);
+    out->bytes_out = __atomic_load_n(&stats.bytes_out, __ATOMIC_RELAXED);
+    out->gzip = __atomic_load_n(&stats.gzip, __ATOMIC_RELAXED);
+    out->deflate = __atomic_load_n(&stats.deflate, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,47 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+#include "mongoose.h"
+#include "rbuf.h"
+
+// Content-Encoding for the kjv replies. A cacheable body is compressed
+// once, as a gzip member kept next to the plain bytes in its rbuf, so the
+// caches hold and account for both; deflate replies reuse the compressed
+// stream of that member inside zlib framing. Bodies smaller than
+// COMPRESS_MIN_BYTES are always sent as they are.
+#define COMPRESS_MIN_BYTES 1024
+
+enum encoding { ENC_IDENTITY, ENC_GZIP, ENC_DEFLATE };
+
+struct compress_stats {
+    unsigned long bodies;      // bodies compressed
+    unsigned long bytes_in;    // their plain bytes
+    unsigned long bytes_out;   // their gzip bytes
+    unsigned long gzip;        // replies sent gzip encoded
+    unsigned long deflate;     // replies sent deflate encoded
+};
+
+// Returns the encoding hm accepts with the highest q-value, gzip winning
+// ties, or ENC_IDENTITY.
+enum encoding compress_negotiate(struct mg_http_message *hm);
+
+// Attaches the gzip copy of b unless b is too small or would not shrink.
+// Call it before b is shared. Returns 0, or -1 on error.
+int compress_body(struct rbuf *b);
+
+// Room compress_parts needs for framing.
+#define COMPRESS_FRAME 24
+
+// Splits the reply of b in encoding enc, which b must have a gzip copy for
+// unless enc is ENC_IDENTITY, into at most four parts sent back to back.
+// The hlen plain bytes at head, at most 65535, go first: when compressing
+// they are stored uncompressed in a block of their own, so one cached copy
+// of b serves any head. frame holds the framing. Returns the number of
+// parts and counts the reply.
+int compress_parts(const struct rbuf *b, enum encoding enc, const char *head,
+                   size_t hlen, char frame[COMPRESS_FRAME], struct mg_str parts[4]);
+
+// The Content-Encoding header value for enc.
+const char *compress_name(enum encoding enc);
+
+void compress_get_stats(struct compress_stats *out);
+#endif // COMPRESS_H
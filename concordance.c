@@ -0,0 +1,100 @@
+#include "concordance.h"
+#include "search_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct word {
+    uint32_t count, verses;
+    uint32_t book, nbooks; // first entry in books and how many
+    uint32_t ordinal;      // first entry in ordinals
+};
+
+static struct {
+    struct word *words; // by search index term
+    uint32_t nwords;
+    struct concordance_book *books;
+    uint32_t nbooks;
+    uint32_t *ordinals;
+    size_t nordinals;
+    const struct corpus *cp;
+} cc;
+
+static void count_word(const char *term, uint32_t count, void *arg) {
+    (void)term;
+    (void)arg;
+    cc.words[cc.nwords++].count = count;
+}
+
+// Appends verse to the current word, opening an entry for its book when
+// it is not the book of the word's previous verse.
+static void add_verse(uint32_t verse, uint32_t tf, void *arg) {
+    struct word *w = arg;
+    uint32_t book = cc.cp->verse_book[verse];
+    if (w->nbooks == 0 || cc.books[cc.nbooks - 1].book != book) {
+        cc.books[cc.nbooks++] = (struct concordance_book){book, 0, 0};
+        w->nbooks++;
+    }
+    cc.books[cc.nbooks - 1].count += tf;
+    cc.books[cc.nbooks - 1].verses++;
+    cc.ordinals[cc.nordinals++] = verse;
+    w->verses++;
+}
+
+int concordance_build(const struct corpus *cp) {
+    struct search_stats ss;
+    size_t total;
+
+    concordance_free();
+    search_get_stats(&ss);
+    // A word's verses span no more books than it has verses, so the
+    // postings bound both arrays.
+    total = ss.postings;
+    if ((cc.words = calloc(ss.terms ? ss.terms : 1, sizeof(*cc.words))) == NULL) goto oom;
+    search_index_each_term(count_word, NULL);
+    if ((cc.ordinals = malloc((total ? total : 1) * sizeof(*cc.ordinals))) == NULL ||
+        (cc.books = malloc((total ? total : 1) * sizeof(*cc.books))) == NULL)
+        goto oom;
+
+    cc.cp = cp;
+    for (uint32_t t = 0; t < cc.nwords; ++t) {
+        struct word *w = &cc.words[t];
+        w->book = cc.nbooks;
+        w->ordinal = (uint32_t)cc.nordinals;
+        search_term_postings(t, add_verse, w);
+    }
+    // Give back what the bound overshot.
+    struct concordance_book *p = realloc(cc.books, (cc.nbooks ? cc.nbooks : 1) * sizeof(*p));
+    if (p) cc.books = p;
+    return 0;
+
+oom:
+    fprintf(stderr, "concordance: out of memory\n");
+    concordance_free();
+    return -1;
+}
+
+void concordance_free(void) {
+    free(cc.words);
+    free(cc.books);
+    free(cc.ordinals);
+    memset(&cc, 0, sizeof(cc));
+}
+
+int concordance_lookup(const char *word, struct concordance_entry *out,
+                       char *err, size_t errlen) {
+    long t = search_term_find(word);
+    memset(out, 0, sizeof(*out));
+    if (t == -2) {
+        snprintf(err, errlen, "word must be a single term");
+        return -1;
+    }
+    if (t < 0 || (uint32_t)t >= cc.nwords) return 0;
+    const struct word *w = &cc.words[t];
+    out->count = w->count;
+    out->verses = w->verses;
+    out->books = cc.books + w->book;
+    out->nbooks = w->nbooks;
+    out->ordinals = cc.ordinals + w->ordinal;
+    return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef CONCORDANCE_H
+#define CONCORDANCE_H
+#include <stddef.h>
+#include <stdint.h>
+#include "corpus.h"
+
+// Concordance of every word of the search index, computed when the corpus
+// is loaded: how often the word occurs in each book and the ordinals of
+// the verses holding it, so frequency questions are answered by a lookup.
+// Read-only once built and safe to query from any thread.
+
+struct concordance_book {
+    uint32_t book;
+    uint32_t count;  // occurrences in the book
+    uint32_t verses; // verses of the book containing the word
+};
+
+struct concordance_entry {
+    uint32_t count, verses; // across the corpus
+    const struct concordance_book *books; // in book order, only books with the word
+    uint32_t nbooks;
+    const uint32_t *ordinals; // of the verses, in corpus order; verses of them
+};
+
+// Builds the concordance from the search index and cp. Returns 0 on
+// success, -1 on allocation failure.
+int concordance_build(const struct corpus *cp);
+void concordance_free(void);
+
+// Fills out for word, folded like a search term; a word no verse holds
+// gets an empty entry. Returns 0, or -1 and a one-line reason in err if
+// word is not a single term.
+int concordance_lookup(const char *word, struct concordance_entry *out,
+                       char *err, size_t errlen);
+#endif // CONCORDANCE_H
@@ -0,0 +1,516 @@
+#include "corpus.h"
+#include <limits.h>
+#include <sqlite3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary corpus file layout, all integers in host byte order:
+//
+//   struct file_header
+//   section 0 .. SEC_COUNT-1, each starting on an 8-byte boundary
+//
+// Sections hold the arrays of struct corpus verbatim, so mapping the file
+// read-only is all it takes to serve from it. Bump CORPUS_FILE_VERSION
+// whenever a section is added or changes meaning.
+#define CORPUS_FILE_MAGIC "KJVCORP"
+#define CORPUS_FILE_VERSION 2
+#define CORPUS_BYTE_ORDER 0x01020304u
+
+enum {
+    SEC_BOOK_CHAPTER,
+    SEC_CHAPTER_VERSE,
+    SEC_VERSE_BOOK,
+    SEC_VERSE_CHAPTER,
+    SEC_VERSE_NUMBER,
+    SEC_TEXT_OFFSET,
+    SEC_TEXT,
+    SEC_FRAG_VERSE_OFFSET,
+    SEC_FRAG_VERSE,
+    SEC_FRAG_CHAPTER_OFFSET,
+    SEC_FRAG_CHAPTER,
+    SEC_FRAG_PASSAGE_OFFSET,
+    SEC_FRAG_PASSAGE,
+    SEC_COUNT
+};
+
+struct file_section {
+    uint64_t offset; // from the start of the file
+    uint64_t size;   // in bytes
+};
+
+struct file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t nbooks, nchapters, nverses, nsections;
+    uint64_t digest;
+    struct file_section sections[SEC_COUNT];
+};
+
+static struct corpus loaded;
+static int is_loaded;
+
+// Mapping backing `loaded` when it came from a corpus file.
+static void *map_base;
+static size_t map_len;
+
+// Heap arrays backing `loaded` when it was built from SQLite.
+static struct {
+    uint32_t *book_chapter, *chapter_verse, *text_offset;
+    uint8_t *verse_book;
+    uint16_t *verse_chapter, *verse_number;
+    char *text;
+    uint32_t *frag_offset[CORPUS_FRAG_COUNT];
+    char *frag[CORPUS_FRAG_COUNT];
+} heap;
+
+static void free_heap(void) {
+    free(heap.book_chapter);
+    free(heap.chapter_verse);
+    free(heap.text_offset);
+    free(heap.verse_book);
+    free(heap.verse_chapter);
+    free(heap.verse_number);
+    free(heap.text);
+    for (int k = 0; k < CORPUS_FRAG_COUNT; ++k) {
+        free(heap.frag_offset[k]);
+        free(heap.frag[k]);
+    }
+    memset(&heap, 0, sizeof(heap));
+}
+
+// Grows *p so that it holds at least n elements of size sz.
+static int reserve(void *p, size_t *cap, size_t n, size_t sz) {
+    if (n <= *cap) return 0;
+    size_t ncap = *cap ? *cap * 2 : 1024;
+    while (ncap < n) ncap *= 2;
+    void *np = realloc(*(void **)p, ncap * sz);
+    if (!np) return -1;
+    *(void **)p = np;
+    *cap = ncap;
+    return 0;
+}
+
+// Doubles the capacity of every per-verse column together.
+static int grow_verses(size_t *cap) {
+    size_t n = *cap ? *cap * 2 : 1024;
+    void *p;
+    if (!(p = realloc(heap.verse_book, n * sizeof(uint8_t)))) return -1;
+    heap.verse_book = p;
+    if (!(p = realloc(heap.verse_chapter, n * sizeof(uint16_t)))) return -1;
+    heap.verse_chapter = p;
+    if (!(p = realloc(heap.verse_number, n * sizeof(uint16_t)))) return -1;
+    heap.verse_number = p;
+    if (!(p = realloc(heap.text_offset, (n + 1) * sizeof(uint32_t)))) return -1;
+    heap.text_offset = p;
+    *cap = n;
+    return 0;
+}
+
+static uint64_t fnv1a(uint64_t h, const void *p, size_t n) {
+    const unsigned char *b = p;
+    for (size_t i = 0; i < n; ++i) h = (h ^ b[i]) * 0x100000001b3ull;
+    return h;
+}
+
+// Fills the address and byte size of every section of cp.
+static void corpus_sections(const struct corpus *cp, const void *ptr[SEC_COUNT],
+                            uint64_t size[SEC_COUNT]) {
+    ptr[SEC_BOOK_CHAPTER] = cp->book_chapter;
+    size[SEC_BOOK_CHAPTER] = ((uint64_t)cp->nbooks + 2) * sizeof(uint32_t);
+    ptr[SEC_CHAPTER_VERSE] = cp->chapter_verse;
+    size[SEC_CHAPTER_VERSE] = ((uint64_t)cp->nchapters + 1) * sizeof(uint32_t);
+    ptr[SEC_VERSE_BOOK] = cp->verse_book;
+    size[SEC_VERSE_BOOK] = (uint64_t)cp->nverses * sizeof(uint8_t);
+    ptr[SEC_VERSE_CHAPTER] = cp->verse_chapter;
+    size[SEC_VERSE_CHAPTER] = (uint64_t)cp->nverses * sizeof(uint16_t);
+    ptr[SEC_VERSE_NUMBER] = cp->verse_number;
+    size[SEC_VERSE_NUMBER] = (uint64_t)cp->nverses * sizeof(uint16_t);
+    ptr[SEC_TEXT_OFFSET] = cp->text_offset;
+    size[SEC_TEXT_OFFSET] = ((uint64_t)cp->nverses + 1) * sizeof(uint32_t);
+    ptr[SEC_TEXT] = cp->text;
+    size[SEC_TEXT] = cp->text_offset ? cp->text_offset[cp->nverses] : 0;
+    for (int k = 0; k < CORPUS_FRAG_COUNT; ++k) {
+        int sec = SEC_FRAG_VERSE_OFFSET + 2 * k;
+        ptr[sec] = cp->frag_offset[k];
+        size[sec] = ((uint64_t)cp->nverses + 1) * sizeof(uint32_t);
+        ptr[sec + 1] = cp->frag[k];
+        size[sec + 1] = cp->frag_offset[k] ? cp->frag_offset[k][cp->nverses] : 0;
+    }
+}
+
+// Points the arrays of cp at the sections of a mapped file.
+static void corpus_bind(struct corpus *cp, const char *base,
+                        const struct file_section *sec) {
+    cp->book_chapter = (const uint32_t *)(base + sec[SEC_BOOK_CHAPTER].offset);
+    cp->chapter_verse = (const uint32_t *)(base + sec[SEC_CHAPTER_VERSE].offset);
+    cp->verse_book = (const uint8_t *)(base + sec[SEC_VERSE_BOOK].offset);
+    cp->verse_chapter = (const uint16_t *)(base + sec[SEC_VERSE_CHAPTER].offset);
+    cp->verse_number = (const uint16_t *)(base + sec[SEC_VERSE_NUMBER].offset);
+    cp->text_offset = (const uint32_t *)(base + sec[SEC_TEXT_OFFSET].offset);
+    cp->text = base + sec[SEC_TEXT].offset;
+    for (int k = 0; k < CORPUS_FRAG_COUNT; ++k) {
+        int i = SEC_FRAG_VERSE_OFFSET + 2 * k;
+        cp->frag_offset[k] = (const uint32_t *)(base + sec[i].offset);
+        cp->frag[k] = base + sec[i + 1].offset;
+    }
+}
+
+// Appends src to the JSON string being built in *buf, escaping it the same
+// way cJSON_PrintUnformatted does.
+static int append_escaped(char **buf, size_t *cap, size_t *len, const char *src) {
+    static const char hex[] = "0123456789abcdef";
+    for (const unsigned char *p = (const unsigned char *)src; *p; ++p) {
+        if (reserve(buf, cap, *len + 6, 1)) return -1;
+        char *d = *buf + *len;
+        switch (*p) {
+        case '"':  d[0] = '\\'; d[1] = '"'; *len += 2; break;
+        case '\\': d[0] = '\\'; d[1] = '\\'; *len += 2; break;
+        case '\b': d[0] = '\\'; d[1] = 'b'; *len += 2; break;
+        case '\f': d[0] = '\\'; d[1] = 'f'; *len += 2; break;
+        case '\n': d[0] = '\\'; d[1] = 'n'; *len += 2; break;
+        case '\r': d[0] = '\\'; d[1] = 'r'; *len += 2; break;
+        case '\t': d[0] = '\\'; d[1] = 't'; *len += 2; break;
+        default:
+            if (*p < 0x20) {
+                memcpy(d, "\\u00", 4);
+                d[4] = hex[*p >> 4];
+                d[5] = hex[*p & 15];
+                *len += 6;
+            } else {
+                d[0] = (char)*p;
+                *len += 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Renders the three per-verse JSON fragments of the heap corpus. Each
+// fragment is followed by a comma so that a run of adjacent fragments is
+// a ready-made JSON array body once its last comma is dropped.
+static int build_fragments(uint32_t nv) {
+    for (int k = 0; k < CORPUS_FRAG_COUNT; ++k) {
+        size_t cap = 0, len = 0;
+        char head[96];
+        if (!(heap.frag_offset[k] = malloc(((size_t)nv + 1) * sizeof(uint32_t))))
+            return -1;
+        for (uint32_t n = 0; n < nv; ++n) {
+            int hl;
+            if (k == CORPUS_FRAG_VERSE)
+                hl = snprintf(head, sizeof(head), "{\"book\":%d,\"chapter\":%d,\"verse\":%d,\"text\":\"",
+                              heap.verse_book[n], heap.verse_chapter[n], heap.verse_number[n]);
+            else if (k == CORPUS_FRAG_CHAPTER)
+                hl = snprintf(head, sizeof(head), "{\"verse\":%d,\"text\":\"",
+                              heap.verse_number[n]);
+            else
+                hl = snprintf(head, sizeof(head), "{\"chapter\":%d,\"verse\":%d,\"text\":\"",
+                              heap.verse_chapter[n], heap.verse_number[n]);
+            heap.frag_offset[k][n] = (uint32_t)len;
+            if (reserve(&heap.frag[k], &cap, len + (size_t)hl, 1)) return -1;
+            memcpy(heap.frag[k] + len, head, (size_t)hl);
+            len += (size_t)hl;
+            if (append_escaped(&heap.frag[k], &cap, &len,
+                               heap.text + heap.text_offset[n]) ||
+                reserve(&heap.frag[k], &cap, len + 3, 1))
+                return -1;
+            memcpy(heap.frag[k] + len, "\"},", 3);
+            len += 3;
+            if (len > UINT32_MAX) return -1;
+        }
+        heap.frag_offset[k][nv] = (uint32_t)len;
+    }
+    return 0;
+}
+
+static uint64_t corpus_digest(const struct corpus *cp) {
+    const void *ptr[SEC_COUNT];
+    uint64_t size[SEC_COUNT];
+    uint64_t h = 0xcbf29ce484222325ull;
+    corpus_sections(cp, ptr, size);
+    for (int i = 0; i < SEC_COUNT; ++i) h = fnv1a(h, ptr[i], size[i]);
+    return h;
+}
+
+int corpus_load_sqlite(const char *path) {
+    sqlite3 *db = NULL;
+    sqlite3_stmt *stmt = NULL;
+    size_t vcap = 0, ccap = 0, bcap = 0, tcap = 0, tlen = 0;
+    uint32_t nv = 0, nc = 0, nb = 0;
+    int cur_book = 0, cur_chapter = 0, cur_verse = 0, rc = -1;
+
+    corpus_free();
+    if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db,
+            "SELECT book, chapter, verse, text FROM kjv ORDER BY book, chapter, verse",
+            -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "corpus: cannot read %s: %s\n", path, sqlite3_errmsg(db));
+        goto cleanup;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int book = sqlite3_column_int(stmt, 0);
+        int chapter = sqlite3_column_int(stmt, 1);
+        int verse = sqlite3_column_int(stmt, 2);
+        const char *text = (const char *)sqlite3_column_text(stmt, 3);
+        size_t len = (size_t)sqlite3_column_bytes(stmt, 3);
+
+        if (book != cur_book) {
+            if (book <= cur_book || book > UINT8_MAX || chapter != 1 || verse != 1)
+                goto dense;
+            // Books absent from the table get an empty chapter range.
+            if (reserve(&heap.book_chapter, &bcap, (size_t)book + 2, sizeof(uint32_t)))
+                goto oom;
+            while (nb < (uint32_t)book) heap.book_chapter[++nb] = nc;
+            cur_book = book;
+            cur_chapter = 0;
+        }
+        if (chapter != cur_chapter) {
+            if (chapter != cur_chapter + 1 || chapter > UINT16_MAX || verse != 1)
+                goto dense;
+            if (reserve(&heap.chapter_verse, &ccap, (size_t)nc + 2, sizeof(uint32_t)))
+                goto oom;
+            heap.chapter_verse[nc++] = nv;
+            cur_chapter = chapter;
+            cur_verse = 0;
+        }
+        if (verse != cur_verse + 1 || verse > UINT16_MAX) goto dense;
+        cur_verse = verse;
+
+        if ((nv == vcap && grow_verses(&vcap)) ||
+            reserve(&heap.text, &tcap, tlen + len + 1, 1) ||
+            tlen + len + 1 > UINT32_MAX)
+            goto oom;
+
+        heap.verse_book[nv] = (uint8_t)book;
+        heap.verse_chapter[nv] = (uint16_t)chapter;
+        heap.verse_number[nv] = (uint16_t)verse;
+        heap.text_offset[nv] = (uint32_t)tlen;
+        memcpy(heap.text + tlen, text ? text : "", len);
+        tlen += len;
+        heap.text[tlen++] = '\0';
+        nv++;
+    }
+    if (nv == 0) {
+        fprintf(stderr, "corpus: %s has no verses\n", path);
+        goto cleanup;
+    }
+
+    heap.book_chapter[nb + 1] = nc;
+    heap.book_chapter[0] = 0;
+    heap.chapter_verse[nc] = nv;
+    heap.text_offset[nv] = (uint32_t)tlen;
+    if (build_fragments(nv)) goto oom;
+
+    loaded.nbooks = nb;
+    loaded.nchapters = nc;
+    loaded.nverses = nv;
+    loaded.book_chapter = heap.book_chapter;
+    loaded.chapter_verse = heap.chapter_verse;
+    loaded.verse_book = heap.verse_book;
+    loaded.verse_chapter = heap.verse_chapter;
+    loaded.verse_number = heap.verse_number;
+    loaded.text_offset = heap.text_offset;
+    loaded.text = heap.text;
+    for (int k = 0; k < CORPUS_FRAG_COUNT; ++k) {
+        loaded.frag_offset[k] = heap.frag_offset[k];
+        loaded.frag[k] = heap.frag[k];
+    }
+    loaded.digest = corpus_digest(&loaded);
+    is_loaded = 1;
+    rc = 0;
+    goto cleanup;
+
+dense:
+    fprintf(stderr, "corpus: %s is not densely numbered near %d:%d:%d\n",
+            path, cur_book, cur_chapter, cur_verse + 1);
+    goto cleanup;
+oom:
+    fprintf(stderr, "corpus: out of memory loading %s\n", path);
+cleanup:
+    if (rc != 0) free_heap();
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return rc;
+}
+
+int corpus_map(const char *path) {
+    struct stat st;
+    const struct file_header *hdr;
+    int fd;
+
+    corpus_free();
+    if ((fd = open(path, O_RDONLY)) < 0) return -1;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(*hdr)) {
+        close(fd);
+        fprintf(stderr, "corpus: %s is too short\n", path);
+        return -1;
+    }
+    map_len = (size_t)st.st_size;
+    map_base = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map_base == MAP_FAILED) {
+        map_base = NULL;
+        fprintf(stderr, "corpus: cannot map %s\n", path);
+        return -1;
+    }
+
+    hdr = map_base;
+    if (memcmp(hdr->magic, CORPUS_FILE_MAGIC, sizeof(CORPUS_FILE_MAGIC)) != 0 ||
+        hdr->version != CORPUS_FILE_VERSION ||
+        hdr->byte_order != CORPUS_BYTE_ORDER || hdr->nsections != SEC_COUNT) {
+        fprintf(stderr, "corpus: %s is not a version %d corpus file\n", path,
+                CORPUS_FILE_VERSION);
+        goto bad;
+    }
+    for (int i = 0; i < SEC_COUNT; ++i) {
+        const struct file_section *sec = &hdr->sections[i];
+        if (sec->offset % 8 != 0 || sec->offset > map_len ||
+            sec->size > map_len - sec->offset)
+            goto corrupt;
+    }
+
+    const struct file_section *sec = hdr->sections;
+    loaded.nbooks = hdr->nbooks;
+    loaded.nchapters = hdr->nchapters;
+    loaded.nverses = hdr->nverses;
+    loaded.digest = hdr->digest;
+    corpus_bind(&loaded, map_base, sec);
+
+    // Only constant-time checks, so startup never touches the whole file.
+    const void *ptr[SEC_COUNT];
+    uint64_t size[SEC_COUNT];
+    if (loaded.nverses == 0 || sec[SEC_BOOK_CHAPTER].size < 2 * sizeof(uint32_t) ||
+        sec[SEC_TEXT_OFFSET].size < sizeof(uint32_t) || sec[SEC_TEXT].size == 0)
+        goto corrupt;
+    for (int k = 0; k < CORPUS_FRAG_COUNT; ++k)
+        if (sec[SEC_FRAG_VERSE_OFFSET + 2 * k].size < sizeof(uint32_t))
+            goto corrupt;
+    corpus_sections(&loaded, ptr, size);
+    for (int i = 0; i < SEC_COUNT; ++i)
+        if (size[i] != sec[i].size) goto corrupt;
+    if (loaded.book_chapter[loaded.nbooks + 1] != loaded.nchapters ||
+        loaded.chapter_verse[loaded.nchapters] != loaded.nverses ||
+        loaded.text[size[SEC_TEXT] - 1] != '\0')
+        goto corrupt;
+
+    is_loaded = 1;
+    return 0;
+
+corrupt:
+    fprintf(stderr, "corpus: %s is corrupt\n", path);
+bad:
+    corpus_free();
+    return -1;
+}
+
+int corpus_write(const struct corpus *cp, const char *path) {
+    struct file_header hdr;
+    const void *ptr[SEC_COUNT];
+    uint64_t size[SEC_COUNT];
+    static const char pad[8];
+    char tmp[4096];
+    FILE *fp;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CORPUS_FILE_MAGIC, sizeof(CORPUS_FILE_MAGIC));
+    hdr.version = CORPUS_FILE_VERSION;
+    hdr.byte_order = CORPUS_BYTE_ORDER;
+    hdr.nbooks = cp->nbooks;
+    hdr.nchapters = cp->nchapters;
+    hdr.nverses = cp->nverses;
+    hdr.nsections = SEC_COUNT;
+    hdr.digest = cp->digest;
+
+    corpus_sections(cp, ptr, size);
+    uint64_t off = (sizeof(hdr) + 7) & ~(uint64_t)7;
+    for (int i = 0; i < SEC_COUNT; ++i) {
+        hdr.sections[i].offset = off;
+        hdr.sections[i].size = size[i];
+        off = (off + size[i] + 7) & ~(uint64_t)7;
+    }
+
+    // Write to a temporary name and rename, so a running server that maps
+    // the old file keeps a consistent view.
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if ((fp = fopen(tmp, "wb")) == NULL) {
+        fprintf(stderr, "corpus: cannot create %s\n", tmp);
+        return -1;
+    }
+    uint64_t pos = 0;
+    int ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    pos += sizeof(hdr);
+    for (int i = 0; ok && i < SEC_COUNT; ++i) {
+        uint64_t gap = hdr.sections[i].offset - pos;
+        ok = fwrite(pad, 1, gap, fp) == gap &&
+             (size[i] == 0 || fwrite(ptr[i], 1, size[i], fp) == size[i]);
+        pos = hdr.sections[i].offset + size[i];
+    }
+    if (fclose(fp) != 0 || !ok || rename(tmp, path) != 0) {
+        fprintf(stderr, "corpus: cannot write %s\n", path);
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+void corpus_free(void) {
+    if (map_base) munmap(map_base, map_len);
+    map_base = NULL;
+    map_len = 0;
+    free_heap();
+    memset(&loaded, 0, sizeof(loaded));
+    is_loaded = 0;
+}
+
+const struct corpus *corpus_get(void) {
+    return is_loaded ? &loaded : NULL;
+}
+
+long corpus_chapter_index(const struct corpus *cp, int book, int chapter) {
+    if (book < 1 || (uint32_t)book > cp->nbooks || chapter < 1) return -1;
+    uint32_t c0 = cp->book_chapter[book], c1 = cp->book_chapter[book + 1];
+    if ((uint32_t)chapter > c1 - c0) return -1;
+    return (long)(c0 + (uint32_t)chapter - 1);
+}
+
+long corpus_ordinal(const struct corpus *cp, int book, int chapter, int verse) {
+    long ci = corpus_chapter_index(cp, book, chapter);
+    if (ci < 0 || verse < 1) return -1;
+    uint32_t v0 = cp->chapter_verse[ci], v1 = cp->chapter_verse[ci + 1];
+    if ((uint32_t)verse > v1 - v0) return -1;
+    return (long)(v0 + (uint32_t)verse - 1);
+}
+
+uint32_t corpus_lower_bound(const struct corpus *cp, int book, int chapter,
+                            int verse) {
+    if (book < 1) return 0;
+    if ((uint32_t)book > cp->nbooks) return cp->nverses;
+    uint32_t c0 = cp->book_chapter[book], c1 = cp->book_chapter[book + 1];
+    if (chapter < 1) return cp->chapter_verse[c0];
+    if ((uint32_t)chapter > c1 - c0) return cp->chapter_verse[c1];
+    uint32_t ci = c0 + (uint32_t)chapter - 1;
+    uint32_t v0 = cp->chapter_verse[ci], v1 = cp->chapter_verse[ci + 1];
+    if (verse < 1) return v0;
+    if ((uint32_t)verse > v1 - v0) return v1;
+    return v0 + (uint32_t)verse - 1;
+}
+
+uint32_t corpus_passage(const struct corpus *cp, int book, int start_chapter,
+                        int start_verse, int end_book, int end_chapter,
+                        int end_verse, uint32_t *first, uint32_t *end) {
+    *first = *end = 0;
+    if (book < 1 || (uint32_t)book > cp->nbooks) return 0;
+    uint32_t lo = corpus_lower_bound(cp, book, start_chapter, start_verse);
+    uint32_t hi = corpus_lower_bound(cp, end_book, end_chapter,
+                                     end_verse == INT_MAX ? end_verse : end_verse + 1);
+    if (hi <= lo) return 0;
+    *first = lo;
+    *end = hi;
+    return hi - lo;
+}
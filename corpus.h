@@ -0,0 +1,95 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Pre-serialized JSON objects kept for every verse.
+enum corpus_frag {
+    CORPUS_FRAG_VERSE,   // {"book":B,"chapter":C,"verse":V,"text":"..."}
+    CORPUS_FRAG_CHAPTER, // {"verse":V,"text":"..."}
+    CORPUS_FRAG_PASSAGE, // {"chapter":C,"verse":V,"text":"..."}
+    CORPUS_FRAG_COUNT
+};
+
+// Read-only columnar copy of the kjv table. Verses are numbered by a dense
+// global ordinal in (book, chapter, verse) order, so a chapter or a passage
+// within a book is a contiguous ordinal range.
+struct corpus {
+    uint32_t nbooks;    // highest book number; books are 1-based
+    uint32_t nchapters; // total chapters across all books
+    uint32_t nverses;   // total verses
+
+    // Chapters of book b are [book_chapter[b], book_chapter[b + 1]).
+    // Length nbooks + 2; books missing from the table have no chapters.
+    const uint32_t *book_chapter;
+    // Verses of chapter index i are [chapter_verse[i], chapter_verse[i + 1]).
+    // Length nchapters + 1.
+    const uint32_t *chapter_verse;
+
+    // Per-ordinal columns, length nverses.
+    const uint8_t *verse_book;
+    const uint16_t *verse_chapter;
+    const uint16_t *verse_number;
+
+    // Text of verse n is text + text_offset[n], NUL-terminated, and its
+    // length is text_offset[n + 1] - text_offset[n] - 1. Length nverses + 1.
+    const uint32_t *text_offset;
+    const char *text;
+
+    // Fragment of kind k for verse n is frag[k] + frag_offset[k][n], up to
+    // frag_offset[k][n + 1]. Each fragment ends with a ',' separator so
+    // adjacent verses form a JSON array body. Offsets have length nverses + 1.
+    const uint32_t *frag_offset[CORPUS_FRAG_COUNT];
+    const char *frag[CORPUS_FRAG_COUNT];
+
+    // FNV-1a hash over all of the above; changes whenever the content does.
+    uint64_t digest;
+};
+
+// Loads the kjv table from the SQLite database at path. Returns 0 on
+// success, -1 if the table cannot be read or is not densely numbered.
+int corpus_load_sqlite(const char *path);
+// Maps a corpus file written by corpus_write read-only. Pages are shared
+// with every other process mapping the same file. Returns 0 on success,
+// -1 if the file is missing, of another version or corrupt.
+int corpus_map(const char *path);
+// Writes cp to path in the binary corpus format. Returns 0 or -1.
+int corpus_write(const struct corpus *cp, const char *path);
+void corpus_free(void);
+
+// Returns the loaded corpus, or NULL if none is loaded.
+const struct corpus *corpus_get(void);
+
+// Returns the ordinal of the verse, or -1 if it does not exist.
+long corpus_ordinal(const struct corpus *cp, int book, int chapter, int verse);
+
+// Returns the chapter index of (book, chapter), or -1 if it does not exist.
+long corpus_chapter_index(const struct corpus *cp, int book, int chapter);
+
+// Returns the first ordinal at or after (book, chapter, verse) in corpus
+// order. Out-of-range components clamp to the start or end of their book,
+// chapter or the whole corpus.
+uint32_t corpus_lower_bound(const struct corpus *cp, int book, int chapter,
+                            int verse);
+
+// Sets [*first, *end) to the verses of the passage from (book,
+// start_chapter, start_verse) through (end_book, end_chapter, end_verse),
+// using the same inclusive bounds as the SQL passage query. The passage
+// may cross books. Returns the number of verses.
+uint32_t corpus_passage(const struct corpus *cp, int book, int start_chapter,
+                        int start_verse, int end_book, int end_chapter,
+                        int end_verse, uint32_t *first, uint32_t *end);
+
+static inline const char *corpus_text(const struct corpus *cp, uint32_t n,
+                                      size_t *len) {
+    if (len) *len = cp->text_offset[n + 1] - cp->text_offset[n] - 1;
+    return cp->text + cp->text_offset[n];
+}
+// Returns the comma-separated fragments of kind k for verses [first, end),
+// without the trailing separator.
+static inline const char *corpus_frags(const struct corpus *cp, enum corpus_frag k,
+                                       uint32_t first, uint32_t end, size_t *len) {
+    *len = cp->frag_offset[k][end] - cp->frag_offset[k][first] - 1;
+    return cp->frag[k] + cp->frag_offset[k][first];
+}
+#endif // CORPUS_H
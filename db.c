@@ -0,0 +1,69 @@
+#include "db.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *const stmt_sql[DB_STMT_COUNT] = {
+    [DB_STMT_VERSE] =
+        "SELECT text FROM kjv WHERE book=? AND chapter=? AND verse=?",
+    [DB_STMT_CHAPTER] =
+        "SELECT verse, text FROM kjv WHERE book=? AND chapter=? ORDER BY verse ASC",
+    [DB_STMT_PASSAGE] =
+        "SELECT book, chapter, verse, text FROM kjv WHERE (book, chapter, verse) BETWEEN (?, ?, ?) AND (?, ?, ?) ORDER BY book ASC, chapter ASC, verse ASC",
+};
+
+// SQLite connections must not be shared between concurrent threads, so
+// every thread gets its own connection and statement cache on first use.
+static char db_path[4096];
+static __thread sqlite3 *db;
+static __thread sqlite3_stmt *stmts[DB_STMT_COUNT];
+static struct db_stats stats; // updated atomically
+
+static int open_thread_conn(void) {
+    if (db) return 0;
+    if (!db_path[0]) return -1;
+    if (sqlite3_open_v2(db_path, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        fprintf(stderr, "db: cannot open %s: %s\n", db_path, sqlite3_errmsg(db));
+        sqlite3_close(db);
+        db = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int db_open(const char *path) {
+    if (strlen(path) >= sizeof(db_path)) return -1;
+    strcpy(db_path, path);
+    return open_thread_conn();
+}
+
+void db_close(void) {
+    for (int i = 0; i < DB_STMT_COUNT; ++i) {
+        sqlite3_finalize(stmts[i]);
+        stmts[i] = NULL;
+    }
+    sqlite3_close(db);
+    db = NULL;
+}
+
+sqlite3_stmt *db_stmt(enum db_stmt_id id) {
+    if (id < 0 || id >= DB_STMT_COUNT || open_thread_conn() != 0) return NULL;
+    if (stmts[id]) {
+        sqlite3_reset(stmts[id]);
+        sqlite3_clear_bindings(stmts[id]);
+        __atomic_fetch_add(&stats.reuses, 1, __ATOMIC_RELAXED);
+        return stmts[id];
+    }
+    if (sqlite3_prepare_v3(db, stmt_sql[id], -1, SQLITE_PREPARE_PERSISTENT,
+                           &stmts[id], NULL) != SQLITE_OK) {
+        fprintf(stderr, "db: prepare failed: %s\n", sqlite3_errmsg(db));
+        stmts[id] = NULL;
+        return NULL;
+    }
+    __atomic_fetch_add(&stats.recompiles, 1, __ATOMIC_RELAXED);
+    return stmts[id];
+}
+
+void db_get_stats(struct db_stats *out) {
+    out->reuses = __atomic_load_n(&stats.reuses, __ATOMIC_RELAXED);
+    out->recompiles = __atomic_load_n(&stats.recompiles, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,31 @@
+#ifndef DB_H
+#define DB_H
+#include <sqlite3.h>
+
+// Statements kept prepared for the lifetime of the connection.
+enum db_stmt_id {
+    DB_STMT_VERSE,
+    DB_STMT_CHAPTER,
+    DB_STMT_PASSAGE,
+    DB_STMT_COUNT
+};
+
+struct db_stats {
+    unsigned long reuses;     // db_stmt() calls served by a cached statement
+    unsigned long recompiles; // db_stmt() calls that had to prepare the SQL
+};
+
+// Sets the database path and opens the calling thread's connection.
+// Other threads open their own connection on their first db_stmt call.
+// Returns 0 on success, -1 on error.
+int db_open(const char *path);
+// Closes the calling thread's connection and statements.
+void db_close(void);
+
+// Returns the cached statement for id, reset and with bindings cleared,
+// preparing it first if needed. Returns NULL if the database is not open
+// or the SQL fails to compile. The statement stays owned by the cache.
+sqlite3_stmt *db_stmt(enum db_stmt_id id);
+
+void db_get_stats(struct db_stats *out);
+#endif // DB_H
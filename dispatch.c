@@ -0,0 +1,198 @@
+#include "dispatch.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct node {
+    uint32_t param; // child for "{name}" segments, 0 if none
+    int32_t route;  // first route whose pattern ends here, or -1
+};
+
+// Literal edge from parent to child. Empty slots have no seg.
+struct edge {
+    const char *seg;
+    uint32_t len, hash, parent, child;
+};
+
+struct dispatch {
+    struct dispatch_route *routes;
+    int32_t *next; // next route with the same pattern, or -1
+    struct node *nodes;
+    uint32_t nnodes;
+    struct edge *edges;
+    uint32_t edge_mask;
+    uint32_t *globs; // routes matched with mg_match, in order
+    size_t nglobs;
+};
+
+static uint32_t edge_hash(uint32_t parent, const char *seg, size_t len) {
+    uint32_t h = 2166136261u ^ (parent * 0x9e3779b1u);
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (unsigned char)seg[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Returns the slot of the edge from parent for seg, or the empty slot
+// where it belongs.
+static struct edge *edge_slot(const struct dispatch *d, uint32_t parent,
+                              const char *seg, size_t len, uint32_t hash) {
+    for (uint32_t i = hash & d->edge_mask;; i = (i + 1) & d->edge_mask) {
+        struct edge *e = &d->edges[i];
+        if (e->seg == NULL ||
+            (e->hash == hash && e->parent == parent && e->len == len &&
+             memcmp(e->seg, seg, len) == 0))
+            return e;
+    }
+}
+
+static bool is_glob(const char *pattern) {
+    return strpbrk(pattern, "*#?") != NULL;
+}
+
+static bool is_param(const char *seg, size_t len) {
+    return len >= 2 && seg[0] == '{' && seg[len - 1] == '}';
+}
+
+// Adds the non-glob pattern of route i to the trie. Returns false if it
+// is malformed.
+static bool insert(struct dispatch *d, uint32_t i) {
+    const char *p = d->routes[i].pattern, *end;
+    uint32_t node = 0, nsegs = 0, nparams = 0;
+
+    if (*p++ != '/') return false;
+    for (;; p = end + 1) {
+        for (end = p; *end && *end != '/'; ++end)
+            ;
+        size_t len = (size_t)(end - p);
+        if (++nsegs > DISPATCH_MAX_SEGMENTS) return false;
+        if (is_param(p, len)) {
+            if (++nparams > DISPATCH_MAX_PARAMS) return false;
+            if (d->nodes[node].param == 0) {
+                d->nodes[node].param = d->nnodes;
+                d->nodes[d->nnodes++] = (struct node){0, -1};
+            }
+            node = d->nodes[node].param;
+        } else {
+            uint32_t hash = edge_hash(node, p, len);
+            struct edge *e = edge_slot(d, node, p, len, hash);
+            if (e->seg == NULL) {
+                *e = (struct edge){p, (uint32_t)len, hash, node, d->nnodes};
+                d->nodes[d->nnodes++] = (struct node){0, -1};
+            }
+            node = e->child;
+        }
+        if (*end == '\0') break;
+    }
+
+    int32_t *last = &d->nodes[node].route;
+    while (*last >= 0) last = &d->next[*last];
+    *last = (int32_t)i;
+    return true;
+}
+
+struct dispatch *dispatch_new(const struct dispatch_route *routes, size_t n) {
+    struct dispatch *d = calloc(1, sizeof(*d));
+    size_t nsegs = 0, cap = 2;
+
+    if (!d) return NULL;
+    // Every '/' of a pattern opens at most one node and one edge.
+    for (size_t i = 0; i < n; ++i)
+        for (const char *p = routes[i].pattern; *p; ++p) nsegs += *p == '/';
+    while (cap < 2 * nsegs) cap *= 2;
+    d->routes = malloc((n ? n : 1) * sizeof(*d->routes));
+    d->next = malloc((n ? n : 1) * sizeof(*d->next));
+    d->nodes = malloc((nsegs + 1) * sizeof(*d->nodes));
+    d->edges = calloc(cap, sizeof(*d->edges));
+    d->globs = malloc((n ? n : 1) * sizeof(*d->globs));
+    if (!d->routes || !d->next || !d->nodes || !d->edges || !d->globs) goto fail;
+    if (n) memcpy(d->routes, routes, n * sizeof(*routes));
+    d->edge_mask = (uint32_t)cap - 1;
+    d->nodes[0] = (struct node){0, -1};
+    d->nnodes = 1;
+
+    for (size_t i = 0; i < n; ++i) {
+        d->next[i] = -1;
+        if (is_glob(routes[i].pattern)) {
+            // mg_match fills one capture per wildcard and clears the next.
+            size_t nwild = 0;
+            for (const char *p = routes[i].pattern; *p; ++p) nwild += strchr("*#?", *p) != NULL;
+            if (nwild > DISPATCH_MAX_PARAMS) goto fail;
+            d->globs[d->nglobs++] = (uint32_t)i;
+        } else if (!insert(d, (uint32_t)i)) {
+            goto fail;
+        }
+    }
+    return d;
+
+fail:
+    dispatch_free(d);
+    return NULL;
+}
+
+void dispatch_free(struct dispatch *d) {
+    if (!d) return;
+    free(d->routes);
+    free(d->next);
+    free(d->nodes);
+    free(d->edges);
+    free(d->globs);
+    free(d);
+}
+
+// Returns the node matching segs[i, n) below node, preferring literal
+// edges and backtracking to the "{name}" child, or -1.
+static long walk(const struct dispatch *d, uint32_t node, const struct mg_str *segs,
+                 size_t n, size_t i, struct mg_str *params, size_t nparams) {
+    long found;
+    if (i == n) return d->nodes[node].route >= 0 ? (long)node : -1;
+
+    uint32_t hash = edge_hash(node, segs[i].buf, segs[i].len);
+    const struct edge *e = edge_slot(d, node, segs[i].buf, segs[i].len, hash);
+    if (e->seg && (found = walk(d, e->child, segs, n, i + 1, params, nparams)) >= 0)
+        return found;
+    if (d->nodes[node].param && segs[i].len > 0) {
+        params[nparams] = segs[i];
+        return walk(d, d->nodes[node].param, segs, n, i + 1, params, nparams + 1);
+    }
+    return -1;
+}
+
+static bool method_matches(const struct dispatch_route *r, struct mg_str method) {
+    return r->method == NULL || mg_strcmp(method, mg_str(r->method)) == 0;
+}
+
+long dispatch_find(const struct dispatch *d, struct mg_str method,
+                   struct mg_str path, struct mg_str *params) {
+    struct mg_str segs[DISPATCH_MAX_SEGMENTS], caps[DISPATCH_MAX_PARAMS + 1];
+    size_t nsegs = 0, start = 1;
+    bool bad_method = false;
+
+    if (path.len > 0 && path.buf[0] == '/') {
+        for (size_t i = 1; i <= path.len && nsegs <= DISPATCH_MAX_SEGMENTS; ++i) {
+            if (i < path.len && path.buf[i] != '/') continue;
+            if (nsegs < DISPATCH_MAX_SEGMENTS) segs[nsegs] = mg_str_n(path.buf + start, i - start);
+            nsegs++;
+            start = i + 1;
+        }
+        long node = nsegs <= DISPATCH_MAX_SEGMENTS ? walk(d, 0, segs, nsegs, 0, params, 0) : -1;
+        if (node >= 0) {
+            for (int32_t r = d->nodes[node].route; r >= 0; r = d->next[r])
+                if (method_matches(&d->routes[r], method)) return r;
+            bad_method = true;
+        }
+    }
+
+    for (size_t i = 0; i < d->nglobs; ++i) {
+        const struct dispatch_route *r = &d->routes[d->globs[i]];
+        if (!mg_match(path, mg_str(r->pattern), caps)) continue;
+        if (!method_matches(r, method)) {
+            bad_method = true;
+            continue;
+        }
+        memcpy(params, caps, DISPATCH_MAX_PARAMS * sizeof(*params));
+        return d->globs[i];
+    }
+    return bad_method ? DISPATCH_BAD_METHOD : DISPATCH_NOT_FOUND;
+}
@@ -0,0 +1,39 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+#include "mongoose.h"
+
+// Route lookup on (method, path) whose cost does not grow with the number
+// of routes. Patterns are split at '/' into a trie, and the literal edges
+// of all nodes share one hash table, so each path segment costs a single
+// probe. A "{name}" segment matches any non-empty segment and captures
+// it; literal segments take precedence over it. Patterns using mongoose
+// glob characters (*, # or ?) are tried in order with mg_match, and only
+// when the trie has no match. Read-only once built, so it is safe to use
+// from any thread.
+#define DISPATCH_MAX_PARAMS 8    // captures per route
+#define DISPATCH_MAX_SEGMENTS 16 // longer paths only reach glob routes
+
+// Returned by dispatch_find.
+#define DISPATCH_NOT_FOUND (-1)
+#define DISPATCH_BAD_METHOD (-2)
+
+struct dispatch_route {
+    const char *method; // NULL matches every method
+    const char *pattern;
+};
+
+struct dispatch;
+
+// Builds a dispatcher for routes[0, n); routes sharing a pattern are told
+// apart by method, the first listed winning. Returns NULL on allocation
+// failure or if a pattern is malformed.
+struct dispatch *dispatch_new(const struct dispatch_route *routes, size_t n);
+void dispatch_free(struct dispatch *d);
+
+// Returns the index of the route for method and path and stores its
+// captures, in pattern order, in params, which must have room for
+// DISPATCH_MAX_PARAMS. Returns DISPATCH_NOT_FOUND if no pattern matches
+// path, or DISPATCH_BAD_METHOD if only routes of other methods do.
+long dispatch_find(const struct dispatch *d, struct mg_str method,
+                   struct mg_str path, struct mg_str *params);
+#endif // DISPATCH_H
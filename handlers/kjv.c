@@ -1,206 +1,909 @@
 #include "mongoose.h"
 #include "kjv.h"
-#include <sqlite3.h>
-#include "cJSON.h"
-
-#define DB_PATH "db.db"
+#include "db.h"
+#include "corpus.h"
+#include "chapter_cache.h"
+#include "passage_cache.h"
+#include "pool.h"
+#include "request.h"
+#include "jsonw.h"
+#include "reference.h"
+#include "books.h"
+#include "compress.h"
+#include <ctype.h>
+#include <limits.h>
 
+// Appends head, the fragments of kind k for verses [first, end) and tail.
+static void corpus_json(struct jw *w, const struct corpus *cp, enum corpus_frag k,
+                        const char *head, uint32_t first, uint32_t end,
+                        const char *tail) {
+    size_t hl = strlen(head), tl = strlen(tail), fl;
+    const char *frags = corpus_frags(cp, k, first, end, &fl);
+    jw_reserve(w, hl + fl + tl);
+    jw_raw(w, head, hl);
+    jw_raw(w, frags, fl);
+    jw_raw(w, tail, tl);
+}
 
-// Returns a malloc'd JSON string for the verse, or NULL if not found or error. Caller must free.
-char *query_verse_json(int book, int chapter, int verse) {
-    char sql[256];
-    sqlite3 *db = NULL;
-    sqlite3_stmt *stmt = NULL;
-    char *json_str = NULL;
-    int rc;
+// Appends the JSON for the verse to w. Returns false if it is not found.
+static bool render_verse(struct jw *w, int book, int chapter, int verse) {
+    const struct corpus *cp = corpus_get();
+    if (cp) {
+        long n = corpus_ordinal(cp, book, chapter, verse);
+        if (n < 0) return false;
+        corpus_json(w, cp, CORPUS_FRAG_VERSE, "", (uint32_t)n, (uint32_t)n + 1, "");
+        return true;
+    }
 
-    rc = sqlite3_open(DB_PATH, &db);
-    if (rc != SQLITE_OK) goto cleanup;
+    sqlite3_stmt *stmt = db_stmt(DB_STMT_VERSE);
+    bool found = false;
 
-    mg_snprintf(sql, sizeof(sql),
-        "SELECT text FROM kjv WHERE book=? AND chapter=? AND verse=?");
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if (rc != SQLITE_OK) goto cleanup;
+    if (!stmt) goto cleanup;
 
     sqlite3_bind_int(stmt, 1, book);
     sqlite3_bind_int(stmt, 2, chapter);
     sqlite3_bind_int(stmt, 3, verse);
 
     if (sqlite3_step(stmt) == SQLITE_ROW) {
-        const unsigned char *text = sqlite3_column_text(stmt, 0);
-        cJSON *root = cJSON_CreateObject();
-        if (root) {
-            cJSON_AddNumberToObject(root, "book", book);
-            cJSON_AddNumberToObject(root, "chapter", chapter);
-            cJSON_AddNumberToObject(root, "verse", verse);
-            cJSON_AddStringToObject(root, "text", (const char *)text);
-            json_str = cJSON_PrintUnformatted(root);
-            cJSON_Delete(root);
-        }
+        const char *text = (const char *)sqlite3_column_text(stmt, 0);
+        size_t len = (size_t)sqlite3_column_bytes(stmt, 0);
+        jw_reserve(w, len + 64);
+        jw_lit(w, "{\"book\":");
+        jw_int(w, book);
+        jw_lit(w, ",\"chapter\":");
+        jw_int(w, chapter);
+        jw_lit(w, ",\"verse\":");
+        jw_int(w, verse);
+        jw_lit(w, ",\"text\":");
+        jw_str(w, text ? text : "", text ? len : 0);
+        jw_lit(w, "}");
+        found = true;
     }
 
 cleanup:
-    if (stmt) sqlite3_finalize(stmt);
-    if (db) sqlite3_close(db);
-    return json_str;
+    if (stmt) sqlite3_reset(stmt);
+    return found;
 }
 
-void get_verse(struct mg_connection *c, struct mg_http_message *hm) {
-    // Parse JSON body: expect {"book":1, "chapter":1, "verse":1}
-    double dbook = 0, dchapter = 0, dverse = 0;
-    if (!mg_json_get_num(hm->body, "$.book", &dbook) ||
-        !mg_json_get_num(hm->body, "$.chapter", &dchapter) ||
-        !mg_json_get_num(hm->body, "$.verse", &dverse)) {
-        mg_http_reply(c, 400, "", "Invalid JSON: expected book, chapter, verse\n");
-        return;
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+// Request bodies. Books fit the corpus' 8-bit book column, chapters and
+// verses its 16-bit columns.
+struct verse_req { int book, chapter, verse; };
+struct chapter_req { int book, chapter; };
+// A batch reference runs from (book, chapter, verse) through (end_book,
+// end_chapter, end_verse). Without verse it starts at the chapter's first
+// verse; the end defaults to the start, or to the end of its chapter.
+struct batch_ref { int book, chapter, verse, end_book, end_chapter, end_verse; };
+struct parse_req { char ref[1024]; };
+
+static const struct req_field verse_fields[] = {
+    REQ_FIELD(struct verse_req, book, 1, UINT8_MAX),
+    REQ_FIELD(struct verse_req, chapter, 1, UINT16_MAX),
+    REQ_FIELD(struct verse_req, verse, 1, UINT16_MAX),
+};
+
+static const struct req_field chapter_fields[] = {
+    REQ_FIELD(struct chapter_req, book, 1, UINT8_MAX),
+    REQ_FIELD(struct chapter_req, chapter, 1, UINT16_MAX),
+};
+
+static const struct req_field batch_ref_fields[] = {
+    REQ_FIELD(struct batch_ref, book, 1, UINT8_MAX),
+    REQ_FIELD(struct batch_ref, chapter, 1, UINT16_MAX),
+    REQ_OPT_FIELD(struct batch_ref, verse, 1, UINT16_MAX),
+    REQ_OPT_FIELD(struct batch_ref, end_book, 1, UINT8_MAX),
+    REQ_OPT_FIELD(struct batch_ref, end_chapter, 1, UINT16_MAX),
+    REQ_OPT_FIELD(struct batch_ref, end_verse, 1, UINT16_MAX),
+};
+
+static const struct req_field parse_fields[] = {
+    REQ_STR_FIELD(struct parse_req, ref),
+};
+
+static const struct req_field passage_fields[] = {
+    REQ_FIELD(struct passage_key, book, 1, UINT8_MAX),
+    REQ_FIELD(struct passage_key, start_chapter, 1, UINT16_MAX),
+    REQ_FIELD(struct passage_key, start_verse, 1, UINT16_MAX),
+    REQ_OPT_FIELD(struct passage_key, end_book, 1, UINT8_MAX),
+    REQ_FIELD(struct passage_key, end_chapter, 1, UINT16_MAX),
+    REQ_FIELD(struct passage_key, end_verse, 1, UINT16_MAX),
+};
+
+enum kjv_query { KJV_VERSE, KJV_CHAPTER, KJV_PASSAGE };
+
+static const char *const not_found[] = {
+    [KJV_VERSE] = "Verse not found\n",
+    [KJV_CHAPTER] = "Chapter not found\n",
+    [KJV_PASSAGE] = "Passage not found\n",
+};
+
+// A query handed to the worker pool, with its arguments in query order.
+struct kjv_job {
+    enum kjv_query query;
+    int args[6];
+    enum encoding enc; // accepted by the client
+    char *json;
+};
+
+static bool render_chapter(struct jw *w, int book, int chapter);
+static bool render_passage(struct jw *w, int book, int start_chapter,
+                           int start_verse, int end_book, int end_chapter,
+                           int end_verse);
+
+// Rough body sizes, so the writer usually allocates once.
+static const size_t size_hint[] = {
+    [KJV_VERSE] = 512,
+    [KJV_CHAPTER] = 8192,
+    [KJV_PASSAGE] = 8192,
+};
+
+static bool render_query(struct jw *w, enum kjv_query q, const int *a) {
+    switch (q) {
+    case KJV_VERSE: return render_verse(w, a[0], a[1], a[2]);
+    case KJV_CHAPTER: return render_chapter(w, a[0], a[1]);
+    default: return render_passage(w, a[0], a[1], a[2], a[3], a[4], a[5]);
+    }
+}
+
+// Renders q into a buffer of its own and returns it as a malloc'd string,
+// or NULL if not found or out of memory.
+static char *run_query(enum kjv_query q, const int *a) {
+    struct mg_iobuf io = {NULL, 0, 0, 0};
+    struct jw w;
+    jw_init(&w, &io, size_hint[q]);
+    if (!render_query(&w, q, a)) {
+        mg_iobuf_free(&io);
+        return NULL;
+    }
+    return jw_detach(&w, NULL);
+}
+
+// Replies only change when the corpus does, and that changes their ETag,
+// so caches may keep them for a day before revalidating.
+#define CACHE_MAX_AGE 86400
+
+// Number of arguments of each query.
+static const int nargs[] = {
+    [KJV_VERSE] = 3,
+    [KJV_CHAPTER] = 2,
+    [KJV_PASSAGE] = 6,
+};
+
+// Returns the passage cache key of passage a. With a corpus, both ends are
+// moved onto the first and last verse the passage holds, so requests for
+// the same verses share an entry; the request itself is left as it is, as
+// replies echo it. Passages crossing books render their verses differently,
+// so the key keeps whether a crosses.
+static struct passage_key passage_key_of(const struct corpus *cp, const int *a) {
+    struct passage_key k = {a[0], a[1], a[2], a[3], a[4], a[5]};
+    uint32_t first, end;
+    if (cp && corpus_passage(cp, a[0], a[1], a[2], a[3], a[4], a[5], &first, &end) > 0 &&
+        (cp->verse_book[first] != cp->verse_book[end - 1]) == (a[3] != a[0]))
+        k = (struct passage_key){cp->verse_book[first], cp->verse_chapter[first],
+                                 cp->verse_number[first], cp->verse_book[end - 1],
+                                 cp->verse_chapter[end - 1], cp->verse_number[end - 1]};
+    return k;
+}
+
+// Writes the strong ETag of the reply to q. It names the corpus digest, so
+// it changes whenever the corpus is rebuilt from different data, and for
+// a passage its cache key, which stands for the verses it holds.
+static void query_etag(const struct corpus *cp, enum kjv_query q, const int *a,
+                       char *buf, size_t len) {
+    size_t n = mg_snprintf(buf, len, "\"%016llx", (unsigned long long)cp->digest);
+    if (q == KJV_PASSAGE) {
+        struct passage_key k = passage_key_of(cp, a);
+        n += mg_snprintf(buf + n, len - n, "-%d-%d-%d-%d-%d-%d", k.book, k.start_chapter,
+                         k.start_verse, k.end_book, k.end_chapter, k.end_verse);
+    } else {
+        for (int i = 0; i < nargs[q]; ++i) n += mg_snprintf(buf + n, len - n, "-%d", a[i]);
+    }
+    mg_snprintf(buf + n, len - n, "\"");
+}
+
+// Writes the start of the reply to passage a, the request echoed up to its
+// verses, and returns its length. Caches keep only the rest, so a cached
+// body serves every request for the same verses.
+static size_t passage_head(char *buf, size_t len, const int *a) {
+    char range[32] = "";
+    if (a[3] != a[0]) mg_snprintf(range, sizeof(range), "\"end_book\":%d,", a[3]);
+    return mg_snprintf(buf, len,
+                       "{\"book\":%d,\"start_chapter\":%d,\"start_verse\":%d,"
+                       "%s\"end_chapter\":%d,\"end_verse\":%d,",
+                       a[0], a[1], a[2], range, a[4], a[5]);
+}
+
+// Writes the headers that let HTTP caches keep the reply to q: its
+// lifetime, that it depends on Accept-Encoding and, with a corpus loaded,
+// its ETag. A compressed reply has different bytes, so it gets the weak
+// form of the ETag, which If-None-Match still matches.
+static void cache_headers(enum kjv_query q, const int *a, bool compressed,
+                          char *buf, size_t len) {
+    const struct corpus *cp = corpus_get();
+    size_t n = mg_snprintf(buf, len,
+                           "Cache-Control: public, max-age=%d\r\nVary: Accept-Encoding\r\n",
+                           CACHE_MAX_AGE);
+    if (cp) {
+        char etag[96];
+        query_etag(cp, q, a, etag, sizeof(etag));
+        mg_snprintf(buf + n, len - n, "ETag: %s%s\r\n", compressed ? "W/" : "", etag);
+    }
+}
+
+// Drops the W/ prefix of a weak entity tag.
+static struct mg_str opaque_tag(struct mg_str tag) {
+    if (tag.len >= 2 && tag.buf[0] == 'W' && tag.buf[1] == '/') {
+        tag.buf += 2;
+        tag.len -= 2;
+    }
+    return tag;
+}
+
+// Returns true if the request's If-None-Match lists etag or "*". The weak
+// and strong forms of a tag match each other, as RFC 9110 prescribes for
+// If-None-Match, so a compressed and a plain reply revalidate alike.
+static bool etag_matches(struct mg_http_message *hm, const char *etag) {
+    struct mg_str *inm = mg_http_get_header(hm, "If-None-Match");
+    struct mg_str tag, list, want = opaque_tag(mg_str(etag));
+    if (inm == NULL) return false;
+    list = *inm;
+    while (mg_span(list, &tag, &list, ',')) {
+        while (tag.len > 0 && isspace((unsigned char)tag.buf[0])) tag.buf++, tag.len--;
+        while (tag.len > 0 && isspace((unsigned char)tag.buf[tag.len - 1])) tag.len--;
+        tag = opaque_tag(tag);
+        if (mg_strcmp(tag, mg_str("*")) == 0 || mg_strcmp(tag, want) == 0) return true;
+    }
+    return false;
+}
+
+// True if body goes out compressed to a client accepting enc. It decides
+// the ETag of the reply and of any 304 standing in for it alike.
+static bool sent_compressed(const struct rbuf *body, enum encoding enc) {
+    return enc != ENC_IDENTITY && body->gzip != NULL;
+}
+
+// Sends body as the 200 reply to q, in encoding enc when body has a
+// compressed copy and as it is otherwise, after the echo of a passage
+// request. Large bodies are sent straight from the rbuf rather than copied
+// into c->send.
+static void reply_body(struct mg_connection *c, enum kjv_query q, const int *a,
+                       struct rbuf *body, enum encoding enc) {
+    struct mg_str parts[4];
+    char frame[COMPRESS_FRAME], hdrs[256], head[192];
+    struct jw w;
+    size_t n, hlen = 0, copied = 0;
+
+    if (!sent_compressed(body, enc)) enc = ENC_IDENTITY;
+    n = mg_snprintf(hdrs, sizeof(hdrs), "Content-Type: application/json\r\n");
+    if (enc != ENC_IDENTITY)
+        n += mg_snprintf(hdrs + n, sizeof(hdrs) - n, "Content-Encoding: %s\r\n",
+                         compress_name(enc));
+    cache_headers(q, a, enc != ENC_IDENTITY, hdrs + n, sizeof(hdrs) - n);
+    if (q == KJV_PASSAGE) hlen = passage_head(head, sizeof(head), a);
+    int nparts = compress_parts(body, enc, head, hlen, frame, parts);
+    // Room for the parts too short to be queued by reference.
+    for (int i = 0; i < nparts; ++i)
+        if (parts[i].len < JW_REF_MIN) copied += parts[i].len;
+    jw_http_begin(&w, c, 200, hdrs, copied);
+    for (int i = 0; i < nparts; ++i)
+        jw_ref(&w, enc == ENC_IDENTITY ? body : body->gzip, parts[i].buf, parts[i].len);
+    if (!jw_http_end(&w, c)) mg_http_reply(c, 500, "", "Out of memory\n");
+}
+
+// Renders q straight into c->send, for results no cache keeps.
+static void reply_query(struct mg_connection *c, enum kjv_query q, const int *a) {
+    struct jw w;
+    char hdrs[256];
+    size_t n = mg_snprintf(hdrs, sizeof(hdrs), "Content-Type: application/json\r\n");
+    cache_headers(q, a, false, hdrs + n, sizeof(hdrs) - n);
+    jw_http_begin(&w, c, 200, hdrs, size_hint[q]);
+    if (!render_query(&w, q, a)) {
+        jw_abort(&w);
+        mg_http_reply(c, 404, "", "%s", not_found[q]);
+    } else if (!jw_http_end(&w, c)) {
+        mg_http_reply(c, 500, "", "Out of memory\n");
     }
-    int book = (int)dbook, chapter = (int)dchapter, verse = (int)dverse;
-    char *json = query_verse_json(book, chapter, verse);
-    if (json) {
-        mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s", json);
+}
+
+// Wraps json as a body, compressed when a cache keeps it or enc asks for
+// it. Returns NULL, having freed json, on allocation failure.
+static struct rbuf *make_body(char *json, bool cached, enum encoding enc) {
+    struct rbuf *body = rbuf_wrap(json, strlen(json));
+    if (!body) {
         free(json);
+        return NULL;
+    }
+    if (cached || enc != ENC_IDENTITY) compress_body(body);
+    return body;
+}
+
+// Sends the result of q in encoding enc and hands json to the cache that
+// keeps it, or frees it.
+static void finish_query(struct mg_connection *c, enum kjv_query q,
+                         const int *a, char *json, enum encoding enc) {
+    struct rbuf *body;
+    if (!json) {
+        mg_http_reply(c, 404, "", "%s", not_found[q]);
+        return;
+    }
+    if ((body = make_body(json, q == KJV_PASSAGE, enc)) == NULL) {
+        mg_http_reply(c, 500, "", "Out of memory\n");
+        return;
+    }
+    reply_body(c, q, a, body, enc);
+    if (q == KJV_PASSAGE) {
+        struct passage_key key = passage_key_of(corpus_get(), a);
+        passage_cache_put(&key, body);
+    }
+    rbuf_unref(body);
+}
+
+static void job_work(void *arg) {
+    struct kjv_job *j = arg;
+    j->json = run_query(j->query, j->args);
+}
+
+static void job_done(struct mg_connection *c, void *arg) {
+    struct kjv_job *j = arg;
+    if (c) finish_query(c, j->query, j->args, j->json, j->enc);
+    else free(j->json);
+    free(j);
+}
+
+// Runs q inline when the corpus serves it from memory. Queries that have
+// to go to SQLite run on the worker pool so they cannot stall the loop.
+static void dispatch_query(struct mg_connection *c, enum kjv_query q,
+                           const int *a, enum encoding enc) {
+    struct kjv_job *j;
+    if (!corpus_get() && pool_active() && (j = calloc(1, sizeof(*j))) != NULL) {
+        j->query = q;
+        memcpy(j->args, a, sizeof(j->args));
+        j->enc = enc;
+        if (pool_submit(c, job_work, job_done, j) != 0) {
+            free(j);
+            mg_http_reply(c, 503, "Retry-After: 1\r\n", "Server busy\n");
+        }
+        return;
+    }
+    if (q == KJV_PASSAGE) finish_query(c, q, a, run_query(q, a), enc);
+    else reply_query(c, q, a);
+}
+
+// Answers q from the caches where it can, or with a 304 if the client
+// holds the current reply, and runs it otherwise. Every way of asking for
+// a verse, chapter or passage ends here.
+static void serve_query(struct mg_connection *c, struct mg_http_message *hm,
+                        enum kjv_query q, const int *a) {
+    const struct corpus *cp = corpus_get();
+    enum encoding enc = compress_negotiate(hm);
+    char etag[96], hdrs[192];
+    struct rbuf *body;
+    uint32_t first, end;
+    long ci = -1;
+
+    if (!cp) {
+        // Without a corpus there is no ETag, but passages are still cached.
+        struct passage_key key = passage_key_of(cp, a);
+        if (q == KJV_PASSAGE && (body = passage_cache_get(&key)) != NULL) {
+            reply_body(c, q, a, body, enc);
+            rbuf_unref(body);
+        } else {
+            dispatch_query(c, q, a, enc);
+        }
+        return;
+    }
+    // Replies that do not exist have no ETag to match.
+    bool found = q == KJV_VERSE     ? corpus_ordinal(cp, a[0], a[1], a[2]) >= 0
+                 : q == KJV_CHAPTER ? (ci = corpus_chapter_index(cp, a[0], a[1])) >= 0
+                                    : corpus_passage(cp, a[0], a[1], a[2], a[3], a[4],
+                                                     a[5], &first, &end) > 0;
+    if (!found) {
+        mg_http_reply(c, 404, "", "%s", not_found[q]);
+        return;
+    }
+    query_etag(cp, q, a, etag, sizeof(etag));
+    if (q == KJV_VERSE) {
+        // Verses are too short to compress.
+        if (etag_matches(hm, etag)) {
+            cache_headers(q, a, false, hdrs, sizeof(hdrs));
+            mg_http_reply(c, 304, hdrs, "");
+        } else {
+            reply_query(c, q, a);
+        }
+        return;
+    }
+
+    // Whether the body has a compressed copy decides the ETag, so it is
+    // looked up, or rendered, before answering even a 304.
+    if (q == KJV_CHAPTER) {
+        if ((body = chapter_cache_get((uint32_t)ci)) == NULL) {
+            char *json = query_chapter_json(a[0], a[1]);
+            if (!json || (body = make_body(json, true, enc)) == NULL) {
+                mg_http_reply(c, 500, "", "Out of memory\n");
+                return;
+            }
+            chapter_cache_put((uint32_t)ci, body);
+        }
     } else {
-        mg_http_reply(c, 404, "", "Verse not found\n");
+        struct passage_key key = passage_key_of(cp, a);
+        if ((body = passage_cache_get(&key)) == NULL) {
+            char *json = run_query(q, a);
+            if (!json || (body = make_body(json, true, enc)) == NULL) {
+                mg_http_reply(c, 500, "", "Out of memory\n");
+                return;
+            }
+            passage_cache_put(&key, body);
+        }
+    }
+    if (etag_matches(hm, etag)) {
+        cache_headers(q, a, sent_compressed(body, enc), hdrs, sizeof(hdrs));
+        mg_http_reply(c, 304, hdrs, "");
+    } else {
+        reply_body(c, q, a, body, enc);
+    }
+    rbuf_unref(body);
+}
+
+// Returns a malloc'd JSON string for the verse, or NULL if not found or error. Caller must free.
+char *query_verse_json(int book, int chapter, int verse) {
+    int args[6] = {book, chapter, verse};
+    return run_query(KJV_VERSE, args);
+}
+
+void get_verse(struct mg_connection *c, struct mg_http_message *hm) {
+    // Parse JSON body or query string: expect {"book":1, "chapter":1, "verse":1}
+    struct verse_req req;
+    char err[96];
+    if (req_decode_http(hm, verse_fields, ARRAY_SIZE(verse_fields), &req,
+                        err, sizeof(err)) != 0) {
+        mg_http_reply(c, 400, "", "Invalid request: %s\n", err);
+        return;
     }
+    int args[6] = {req.book, req.chapter, req.verse};
+    serve_query(c, hm, KJV_VERSE, args);
 }
 
 
-// Returns a malloc'd JSON string for the chapter, or NULL if not found or error. Caller must free.
-char *query_chapter_json(int book, int chapter) {
-    char sql[256];
-    sqlite3 *db = NULL;
-    sqlite3_stmt *stmt = NULL;
-    int rc;
-    char *json_str = NULL;
-    cJSON *root = NULL, *verses = NULL;
-
-    rc = sqlite3_open(DB_PATH, &db);
-    if (rc != SQLITE_OK) goto cleanup;
-    mg_snprintf(sql, sizeof(sql),
-        "SELECT verse, text FROM kjv WHERE book=? AND chapter=? ORDER BY verse ASC");
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if (rc != SQLITE_OK) goto cleanup;
+// Appends the JSON for the chapter to w. Returns false if it is not found.
+static bool render_chapter(struct jw *w, int book, int chapter) {
+    const struct corpus *cp = corpus_get();
+    if (cp) {
+        uint32_t first, end;
+        char head[64];
+        if (corpus_passage(cp, book, chapter, 1, book, chapter, INT_MAX, &first, &end) == 0)
+            return false;
+        mg_snprintf(head, sizeof(head), "{\"book\":%d,\"chapter\":%d,\"verses\":[",
+                    book, chapter);
+        corpus_json(w, cp, CORPUS_FRAG_CHAPTER, head, first, end, "]}");
+        return true;
+    }
+
+    sqlite3_stmt *stmt = db_stmt(DB_STMT_CHAPTER);
+    int nverses = 0;
+
+    if (!stmt) goto cleanup;
     sqlite3_bind_int(stmt, 1, book);
     sqlite3_bind_int(stmt, 2, chapter);
 
-    root = cJSON_CreateObject();
-    if (!root) goto cleanup;
-    cJSON_AddNumberToObject(root, "book", book);
-    cJSON_AddNumberToObject(root, "chapter", chapter);
-    verses = cJSON_CreateArray();
-    if (!verses) goto cleanup;
-
+    jw_lit(w, "{\"book\":");
+    jw_int(w, book);
+    jw_lit(w, ",\"chapter\":");
+    jw_int(w, chapter);
+    jw_lit(w, ",\"verses\":[");
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        int verse = sqlite3_column_int(stmt, 0);
-        const unsigned char *text = sqlite3_column_text(stmt, 1);
-        cJSON *vobj = cJSON_CreateObject();
-        if (!vobj) continue;
-        cJSON_AddNumberToObject(vobj, "verse", verse);
-        cJSON_AddStringToObject(vobj, "text", (const char *)text);
-        cJSON_AddItemToArray(verses, vobj);
-    }
-    cJSON_AddItemToObject(root, "verses", verses);
-    if (cJSON_GetArraySize(verses) == 0) goto cleanup;
-    json_str = cJSON_PrintUnformatted(root);
+        const char *text = (const char *)sqlite3_column_text(stmt, 1);
+        size_t len = (size_t)sqlite3_column_bytes(stmt, 1);
+        if (nverses++ > 0) jw_lit(w, ",");
+        jw_lit(w, "{\"verse\":");
+        jw_int(w, sqlite3_column_int(stmt, 0));
+        jw_lit(w, ",\"text\":");
+        jw_str(w, text ? text : "", text ? len : 0);
+        jw_lit(w, "}");
+    }
+    jw_lit(w, "]}");
 
 cleanup:
-    if (stmt) sqlite3_finalize(stmt);
-    if (db) sqlite3_close(db);
-    if (root) cJSON_Delete(root);
-    return json_str;
+    if (stmt) sqlite3_reset(stmt);
+    return nverses > 0;
+}
+
+// Returns a malloc'd JSON string for the chapter, or NULL if not found or error. Caller must free.
+char *query_chapter_json(int book, int chapter) {
+    int args[6] = {book, chapter};
+    return run_query(KJV_CHAPTER, args);
+}
+
+void kjv_warm_cache(void) {
+    const struct corpus *cp = corpus_get();
+    if (!cp) return;
+    for (uint32_t book = 1; book <= cp->nbooks; ++book) {
+        uint32_t n = cp->book_chapter[book + 1] - cp->book_chapter[book];
+        for (uint32_t chapter = 1; chapter <= n; ++chapter) {
+            char *json = query_chapter_json((int)book, (int)chapter);
+            struct rbuf *body = json ? rbuf_wrap(json, strlen(json)) : NULL;
+            if (!body) {
+                free(json);
+                continue;
+            }
+            compress_body(body);
+            chapter_cache_put(cp->book_chapter[book] + chapter - 1, body);
+            rbuf_unref(body);
+        }
+    }
 }
 
 void get_chapter(struct mg_connection *c, struct mg_http_message *hm) {
-    // Parse JSON body: expect {"book":1, "chapter":1}
-    double dbook = 0, dchapter = 0;
-    if (!mg_json_get_num(hm->body, "$.book", &dbook) ||
-        !mg_json_get_num(hm->body, "$.chapter", &dchapter)) {
-        mg_http_reply(c, 400, "", "Invalid JSON: expected book, chapter\n");
+    // Parse JSON body or query string: expect {"book":1, "chapter":1}
+    struct chapter_req req;
+    char err[96];
+    if (req_decode_http(hm, chapter_fields, ARRAY_SIZE(chapter_fields), &req,
+                        err, sizeof(err)) != 0) {
+        mg_http_reply(c, 400, "", "Invalid request: %s\n", err);
         return;
     }
-    int book = (int)dbook, chapter = (int)dchapter;
-    char *json = query_chapter_json(book, chapter);
-    if (json) {
-        mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s", json);
-        free(json);
-    } else {
-        mg_http_reply(c, 404, "", "Chapter not found\n");
-    }
+    int args[6] = {req.book, req.chapter};
+    serve_query(c, hm, KJV_CHAPTER, args);
 }
 
+// Appends the JSON for the passage to w from its verses on, as what comes
+// before echoes the request and passage_head writes it. Returns false if
+// it is empty. A passage within one book lists chapter and verse of each
+// verse; one that crosses books carries the book of each verse too.
+static bool render_passage(struct jw *w, int book, int start_chapter,
+                           int start_verse, int end_book, int end_chapter,
+                           int end_verse) {
+    bool cross = end_book != book;
+    const struct corpus *cp = corpus_get();
+    if (cp) {
+        uint32_t first, end;
+        // The passage is one contiguous run of ordinals, whatever books
+        // it spans.
+        if (corpus_passage(cp, book, start_chapter, start_verse, end_book,
+                           end_chapter, end_verse, &first, &end) == 0)
+            return false;
+        corpus_json(w, cp, cross ? CORPUS_FRAG_VERSE : CORPUS_FRAG_PASSAGE,
+                    "\"verses\":[", first, end, "]}");
+        return true;
+    }
+
+    sqlite3_stmt *stmt = db_stmt(DB_STMT_PASSAGE);
+    int nverses = 0;
 
-// Returns a malloc'd JSON string for the passage, or NULL if not found or error. Caller must free.
-char *query_passage_json(int book, int start_chapter, int start_verse, int end_chapter, int end_verse) {
-    char sql[512];
-    sqlite3 *db = NULL;
-    sqlite3_stmt *stmt = NULL;
-    int rc;
-    char *json_str = NULL;
-    cJSON *root = NULL, *verses = NULL;
-
-    rc = sqlite3_open(DB_PATH, &db);
-    if (rc != SQLITE_OK) goto cleanup;
-    mg_snprintf(sql, sizeof(sql),
-        "SELECT chapter, verse, text FROM kjv WHERE book=? AND ((chapter > ? OR (chapter = ? AND verse >= ?)) AND (chapter < ? OR (chapter = ? AND verse <= ?))) ORDER BY chapter ASC, verse ASC");
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if (rc != SQLITE_OK) goto cleanup;
+    if (!stmt) goto cleanup;
     sqlite3_bind_int(stmt, 1, book);
     sqlite3_bind_int(stmt, 2, start_chapter);
-    sqlite3_bind_int(stmt, 3, start_chapter);
-    sqlite3_bind_int(stmt, 4, start_verse);
+    sqlite3_bind_int(stmt, 3, start_verse);
+    sqlite3_bind_int(stmt, 4, end_book);
     sqlite3_bind_int(stmt, 5, end_chapter);
-    sqlite3_bind_int(stmt, 6, end_chapter);
-    sqlite3_bind_int(stmt, 7, end_verse);
-
-    root = cJSON_CreateObject();
-    if (!root) goto cleanup;
-    cJSON_AddNumberToObject(root, "book", book);
-    cJSON_AddNumberToObject(root, "start_chapter", start_chapter);
-    cJSON_AddNumberToObject(root, "start_verse", start_verse);
-    cJSON_AddNumberToObject(root, "end_chapter", end_chapter);
-    cJSON_AddNumberToObject(root, "end_verse", end_verse);
-    verses = cJSON_CreateArray();
-    if (!verses) goto cleanup;
+    sqlite3_bind_int(stmt, 6, end_verse);
 
+    jw_lit(w, "\"verses\":[");
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        int chapter = sqlite3_column_int(stmt, 0);
-        int verse = sqlite3_column_int(stmt, 1);
-        const unsigned char *text = sqlite3_column_text(stmt, 2);
-        cJSON *vobj = cJSON_CreateObject();
-        if (!vobj) continue;
-        cJSON_AddNumberToObject(vobj, "chapter", chapter);
-        cJSON_AddNumberToObject(vobj, "verse", verse);
-        cJSON_AddStringToObject(vobj, "text", (const char *)text);
-        cJSON_AddItemToArray(verses, vobj);
-    }
-    cJSON_AddItemToObject(root, "verses", verses);
-    if (cJSON_GetArraySize(verses) == 0) goto cleanup;
-    json_str = cJSON_PrintUnformatted(root);
+        const char *text = (const char *)sqlite3_column_text(stmt, 3);
+        size_t len = (size_t)sqlite3_column_bytes(stmt, 3);
+        if (nverses++ > 0) jw_lit(w, ",");
+        if (cross) {
+            jw_lit(w, "{\"book\":");
+            jw_int(w, sqlite3_column_int(stmt, 0));
+            jw_lit(w, ",\"chapter\":");
+        } else {
+            jw_lit(w, "{\"chapter\":");
+        }
+        jw_int(w, sqlite3_column_int(stmt, 1));
+        jw_lit(w, ",\"verse\":");
+        jw_int(w, sqlite3_column_int(stmt, 2));
+        jw_lit(w, ",\"text\":");
+        jw_str(w, text ? text : "", text ? len : 0);
+        jw_lit(w, "}");
+    }
+    jw_lit(w, "]}");
 
 cleanup:
-    if (stmt) sqlite3_finalize(stmt);
-    if (db) sqlite3_close(db);
-    if (root) cJSON_Delete(root);
-    return json_str;
+    if (stmt) sqlite3_reset(stmt);
+    return nverses > 0;
+}
+
+// Returns a malloc'd JSON string for the passage, or NULL if not found or error. Caller must free.
+char *query_passage_json(int book, int start_chapter, int start_verse,
+                         int end_book, int end_chapter, int end_verse) {
+    int args[6] = {book, start_chapter, start_verse, end_book, end_chapter, end_verse};
+    char head[192];
+    size_t hlen = passage_head(head, sizeof(head), args);
+    char *tail = run_query(KJV_PASSAGE, args), *json;
+    if (!tail) return NULL;
+    size_t tlen = strlen(tail);
+    if ((json = malloc(hlen + tlen + 1)) != NULL) {
+        memcpy(json, head, hlen);
+        memcpy(json + hlen, tail, tlen + 1);
+    }
+    free(tail);
+    return json;
 }
 
 void get_passage(struct mg_connection *c, struct mg_http_message *hm) {
-    // Parse JSON body: expect {"book":1, "start_chapter":1, "start_verse":1, "end_chapter":1, "end_verse":1}
-    double dbook = 0, dstart_ch = 0, dstart_vs = 0, dend_ch = 0, dend_vs = 0;
-    if (!mg_json_get_num(hm->body, "$.book", &dbook) ||
-        !mg_json_get_num(hm->body, "$.start_chapter", &dstart_ch) ||
-        !mg_json_get_num(hm->body, "$.start_verse", &dstart_vs) ||
-        !mg_json_get_num(hm->body, "$.end_chapter", &dend_ch) ||
-        !mg_json_get_num(hm->body, "$.end_verse", &dend_vs)) {
-        mg_http_reply(c, 400, "", "Invalid JSON: expected book, start_chapter, start_verse, end_chapter, end_verse\n");
+    // Parse JSON body or query string: expect {"book":1, "start_chapter":1, "start_verse":1, "end_chapter":1, "end_verse":1}
+    // and optionally "end_book", which defaults to book.
+    struct passage_key key = {0};
+    char err[96];
+    if (req_decode_http(hm, passage_fields, ARRAY_SIZE(passage_fields), &key,
+                        err, sizeof(err)) != 0) {
+        mg_http_reply(c, 400, "", "Invalid request: %s\n", err);
         return;
     }
-    int book = (int)dbook, start_chapter = (int)dstart_ch, start_verse = (int)dstart_vs, end_chapter = (int)dend_ch, end_verse = (int)dend_vs;
-    char *json = query_passage_json(book, start_chapter, start_verse, end_chapter, end_verse);
-    if (json) {
-        mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s", json);
-        free(json);
+    if (key.end_book == 0) key.end_book = key.book;
+    int args[6] = {key.book, key.start_chapter, key.start_verse,
+                   key.end_book, key.end_chapter, key.end_verse};
+    serve_query(c, hm, KJV_PASSAGE, args);
+}
+
+// Reads a number in 1..max from *p, advancing it. Returns -1 if there is
+// none.
+static int path_num(const char **p, const char *end, int max) {
+    long n = 0;
+    const char *s = *p;
+    while (*p < end && isdigit((unsigned char)**p) && n <= max) n = n * 10 + (*(*p)++ - '0');
+    return *p == s || n < 1 || n > max ? -1 : (int)n;
+}
+
+// Serves the verse, chapter or passage named by a book segment, either a
+// number or a name as book_lookup takes it, and spec: C, C:V, C-C, C-C:V,
+// C:V-V or C:V-C:V.
+static void serve_path(struct mg_connection *c, struct mg_http_message *hm,
+                       struct mg_str book_seg, const char *spec, size_t len) {
+    const struct corpus *cp = corpus_get();
+    const char *p = spec, *end = spec + len;
+    char name[64];
+    int book, n, a[6] = {0};
+    enum kjv_query q;
+
+    int nb = mg_url_decode(book_seg.buf, book_seg.len, name, sizeof(name), 0);
+    const char *np = name;
+    book = nb > 0 ? path_num(&np, name + nb, UINT8_MAX) : 0;
+    if (nb > 0 && (book < 0 || np != name + nb)) book = book_lookup(name, (size_t)nb);
+    if (book <= 0) {
+        mg_http_reply(c, 404, "", "Book not found\n");
+        return;
+    }
+
+    a[0] = a[3] = book;
+    if ((a[1] = path_num(&p, end, UINT16_MAX)) < 0) goto invalid;
+    if (p < end && *p == ':') {
+        ++p;
+        if ((a[2] = path_num(&p, end, UINT16_MAX)) < 0) goto invalid;
+    }
+    if (p == end) {
+        q = a[2] ? KJV_VERSE : KJV_CHAPTER;
+        serve_query(c, hm, q, a);
+        return;
+    }
+    if (*p++ != '-' || (n = path_num(&p, end, UINT16_MAX)) < 0) goto invalid;
+    if (p < end && *p == ':') {
+        ++p;
+        a[4] = n;
+        if ((a[5] = path_num(&p, end, UINT16_MAX)) < 0) goto invalid;
+    } else if (a[2]) {
+        a[4] = a[1], a[5] = n;
     } else {
-        mg_http_reply(c, 404, "", "Passage not found\n");
+        // A range of whole chapters ends with the last verse of the last.
+        long ci = cp ? corpus_chapter_index(cp, book, n) : -1;
+        a[4] = n;
+        a[5] = ci >= 0 ? (int)(cp->chapter_verse[ci + 1] - cp->chapter_verse[ci]) : UINT16_MAX;
+    }
+    if (p != end) goto invalid;
+    if (a[2] == 0) a[2] = 1;
+    serve_query(c, hm, KJV_PASSAGE, a);
+    return;
+
+invalid:
+    mg_http_reply(c, 400, "", "Invalid request: malformed reference \"%.*s\"\n",
+                  (int)len, spec);
+}
+
+void get_book_path(struct mg_connection *c, struct mg_http_message *hm,
+                   const struct mg_str *params) {
+    serve_path(c, hm, params[0], params[1].buf, params[1].len);
+}
+
+void get_verse_path(struct mg_connection *c, struct mg_http_message *hm,
+                    const struct mg_str *params) {
+    char spec[64];
+    int n = mg_snprintf(spec, sizeof(spec), "%.*s:%.*s", (int)params[1].len, params[1].buf,
+                        (int)params[2].len, params[2].buf);
+    serve_path(c, hm, params[0], spec, (size_t)n < sizeof(spec) ? (size_t)n : sizeof(spec) - 1);
+}
+
+// A batch reference resolved to the verses [lo, hi), with the index of
+// its first verse in the reply.
+struct batch_span {
+    uint32_t lo, hi, start;
+    int ref;
+};
+
+static int by_lo(const void *a, const void *b) {
+    const struct batch_span *x = a, *y = b;
+    if (x->lo != y->lo) return x->lo < y->lo ? -1 : 1;
+    return x->ref - y->ref;
+}
+
+// Decodes the refs array of body into spans. Returns how many, or -1 and
+// a reason in err.
+static int decode_batch(const struct corpus *cp, struct mg_str body,
+                        struct batch_span *spans, char *err, size_t errlen) {
+    struct mg_str refs, val;
+    size_t ofs = 0;
+    int n = 0, len = 0, at = mg_json_get(body, "$.refs", &len);
+
+    if (at < 0 || body.buf[at] != '[') {
+        mg_snprintf(err, errlen, "field \"refs\" must be an array");
+        return -1;
+    }
+    refs = mg_str_n(body.buf + at, (size_t)len);
+    while ((ofs = mg_json_next(refs, ofs, NULL, &val)) > 0) {
+        struct batch_ref r = {0};
+        char why[80];
+        if (n == BATCH_MAX_REFS) {
+            mg_snprintf(err, errlen, "more than %d refs", BATCH_MAX_REFS);
+            return -1;
+        }
+        if (val.buf[0] != '{') {
+            mg_snprintf(err, errlen, "ref %d must be an object", n);
+            return -1;
+        }
+        if (req_decode(val, batch_ref_fields, ARRAY_SIZE(batch_ref_fields), &r,
+                       why, sizeof(why)) != 0) {
+            mg_snprintf(err, errlen, "ref %d: %s", n, why);
+            return -1;
+        }
+        if (r.end_book == 0) r.end_book = r.book;
+        if (r.end_chapter == 0) r.end_chapter = r.chapter;
+        if (r.end_verse == 0)
+            r.end_verse = r.verse && r.end_book == r.book && r.end_chapter == r.chapter
+                              ? r.verse : INT_MAX;
+        corpus_passage(cp, r.book, r.chapter, r.verse, r.end_book, r.end_chapter,
+                       r.end_verse, &spans[n].lo, &spans[n].hi);
+        spans[n].ref = n;
+        n++;
+    }
+    if (n == 0) {
+        mg_snprintf(err, errlen, "field \"refs\" must list 1..%d refs", BATCH_MAX_REFS);
+        return -1;
+    }
+    return n;
+}
+
+void get_batch(struct mg_connection *c, struct mg_http_message *hm) {
+    // Parse JSON body: expect {"refs":[{"book":43, "chapter":3, "verse":16}, ...]},
+    // each ref optionally with "end_book", "end_chapter" and "end_verse".
+    struct batch_span spans[BATCH_MAX_REFS], sorted[BATCH_MAX_REFS];
+    uint32_t runs[2 * BATCH_MAX_REFS], nruns = 0, total = 0;
+    const struct corpus *cp = corpus_get();
+    char err[128];
+    int n;
+
+    if (!cp) {
+        mg_http_reply(c, 503, "", "Batch unavailable\n");
+        return;
+    }
+    if ((n = decode_batch(cp, hm->body, spans, err, sizeof(err))) < 0) {
+        mg_http_reply(c, 400, "", "Invalid request: %s\n", err);
+        return;
+    }
+
+    // Overlapping and adjacent spans merge into runs of the corpus, so
+    // each verse is sent once and every ref is a slice of the reply.
+    memcpy(sorted, spans, (size_t)n * sizeof(*spans));
+    qsort(sorted, (size_t)n, sizeof(*sorted), by_lo);
+    for (int i = 0; i < n; ++i) {
+        struct batch_span *sp = &sorted[i];
+        if (sp->hi == sp->lo) continue;
+        if (nruns == 0 || sp->lo > runs[nruns - 1]) {
+            if (nruns > 0) total += runs[nruns - 1] - runs[nruns - 2];
+            runs[nruns++] = sp->lo;
+            runs[nruns++] = sp->hi;
+        } else if (sp->hi > runs[nruns - 1]) {
+            runs[nruns - 1] = sp->hi;
+        }
+        spans[sp->ref].start = total + (sp->lo - runs[nruns - 2]);
+    }
+    if (nruns > 0) total += runs[nruns - 1] - runs[nruns - 2];
+
+    const uint32_t *fo = cp->frag_offset[CORPUS_FRAG_VERSE];
+    size_t bytes = 64 + (size_t)n * 32;
+    // Long runs are sent from the corpus itself rather than copied.
+    for (uint32_t i = 0; i < nruns; i += 2)
+        if (fo[runs[i + 1]] - fo[runs[i]] < JW_REF_MIN) bytes += fo[runs[i + 1]] - fo[runs[i]];
+
+    struct jw w;
+    jw_http_begin(&w, c, 200, "Content-Type: application/json\r\n", bytes);
+    jw_lit(&w, "{\"refs\":[");
+    for (int i = 0; i < n; ++i) {
+        uint32_t count = spans[i].hi - spans[i].lo;
+        if (i > 0) jw_lit(&w, ",");
+        jw_lit(&w, "{\"start\":");
+        jw_int(&w, count ? spans[i].start : 0);
+        jw_lit(&w, ",\"count\":");
+        jw_int(&w, count);
+        jw_lit(&w, "}");
+    }
+    jw_lit(&w, "],\"verse_count\":");
+    jw_int(&w, total);
+    jw_lit(&w, ",\"verses\":[");
+    for (uint32_t i = 0; i < nruns; i += 2) {
+        size_t len;
+        const char *frags = corpus_frags(cp, CORPUS_FRAG_VERSE, runs[i], runs[i + 1], &len);
+        if (i > 0) jw_lit(&w, ",");
+        jw_ref(&w, NULL, frags, len);
+    }
+    jw_lit(&w, "]}");
+    if (!jw_http_end(&w, c)) mg_http_reply(c, 500, "", "Out of memory\n");
+}
+
+// Appends book, chapter and verse of ordinal n as the start of a
+// passage, or with end as its end, named as get_passage names them.
+static void put_verse(struct jw *w, const struct corpus *cp, uint32_t n, bool end) {
+    if (end) jw_lit(w, ",\"end_book\":");
+    else jw_lit(w, "\"book\":");
+    jw_int(w, cp->verse_book[n]);
+    if (end) jw_lit(w, ",\"end_chapter\":");
+    else jw_lit(w, ",\"start_chapter\":");
+    jw_int(w, cp->verse_chapter[n]);
+    if (end) jw_lit(w, ",\"end_verse\":");
+    else jw_lit(w, ",\"start_verse\":");
+    jw_int(w, cp->verse_number[n]);
+}
+
+void parse_reference(struct mg_connection *c, struct mg_http_message *hm) {
+    // Parse JSON body: expect {"ref":"John 3:16-18; Ps 23"}
+    struct parse_req req;
+    struct ref_range refs[BATCH_MAX_REFS];
+    const struct corpus *cp = corpus_get();
+    char err[128];
+    int n;
+
+    if (!cp) {
+        mg_http_reply(c, 503, "", "Parse unavailable\n");
+        return;
+    }
+    if (req_decode(hm->body, parse_fields, ARRAY_SIZE(parse_fields), &req,
+                   err, sizeof(err)) != 0 ||
+        (n = ref_parse(req.ref, strlen(req.ref), refs, BATCH_MAX_REFS, err,
+                       sizeof(err))) < 0) {
+        mg_http_reply(c, 400, "", "Invalid request: %s\n", err);
+        return;
+    }
+
+    // Ranges come back with the verses they resolve to in the corpus, so
+    // open ends like "Ps 23" name their last verse.
+    struct jw w;
+    jw_http_begin(&w, c, 200, "Content-Type: application/json\r\n", 128 + (size_t)n * 128);
+    jw_lit(&w, "{\"ranges\":[");
+    for (int i = 0; i < n; ++i) {
+        const struct ref_range *r = &refs[i];
+        uint32_t first, end;
+        corpus_passage(cp, r->book, r->start_chapter, r->start_verse, r->end_book,
+                       r->end_chapter, r->end_verse, &first, &end);
+        if (i > 0) jw_lit(&w, ",");
+        jw_lit(&w, "{");
+        if (end > first) {
+            put_verse(&w, cp, first, false);
+            put_verse(&w, cp, end - 1, true);
+        } else {
+            // Nothing in the corpus: the start as parsed, and no end, since
+            // none resolved.
+            jw_lit(&w, "\"book\":");
+            jw_int(&w, r->book);
+            jw_lit(&w, ",\"start_chapter\":");
+            jw_int(&w, r->start_chapter);
+            jw_lit(&w, ",\"start_verse\":");
+            jw_int(&w, r->start_verse);
+        }
+        jw_lit(&w, ",\"first\":");
+        jw_int(&w, first);
+        jw_lit(&w, ",\"count\":");
+        jw_int(&w, end - first);
+        jw_lit(&w, "}");
     }
+    jw_lit(&w, "]}");
+    if (!jw_http_end(&w, c)) mg_http_reply(c, 500, "", "Out of memory\n");
 }
@@ -1,7 +1,28 @@
 #ifndef HANDLERS_KJV_H
 #define HANDLERS_KJV_H
 #include "mongoose.h"
+// Query functions return a malloc'd JSON string, or NULL if not found or error.
+char *query_verse_json(int book, int chapter, int verse);
+char *query_chapter_json(int book, int chapter);
+char *query_passage_json(int book, int start_chapter, int start_verse,
+                         int end_book, int end_chapter, int end_verse);
 void get_verse(struct mg_connection *c, struct mg_http_message *hm);
 void get_chapter(struct mg_connection *c, struct mg_http_message *hm);
 void get_passage(struct mg_connection *c, struct mg_http_message *hm);
+// GET /kjv/{book}/{spec} and /kjv/{book}/{chapter}/{verses}: the book as
+// a number or name and chapter:verse specs such as 3, 3:16, 3:16-18 or
+// 1-150:6, answered like the JSON endpoints, with caching headers.
+void get_book_path(struct mg_connection *c, struct mg_http_message *hm,
+                   const struct mg_str *params);
+void get_verse_path(struct mg_connection *c, struct mg_http_message *hm,
+                    const struct mg_str *params);
+// Resolves up to BATCH_MAX_REFS verse and passage references in one reply,
+// sending each verse once however many of them cover it.
+#define BATCH_MAX_REFS 100
+void get_batch(struct mg_connection *c, struct mg_http_message *hm);
+// Parses a reference string such as "John 3:16-18; Ps 23" into the
+// passage ranges and verse ordinals it names.
+void parse_reference(struct mg_connection *c, struct mg_http_message *hm);
+// Renders every chapter of the loaded corpus into the chapter cache.
+void kjv_warm_cache(void);
 #endif // HANDLERS_KJV_H
\ No newline at end of file
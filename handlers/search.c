@@ -0,0 +1,317 @@
+#include "mongoose.h"
+#include "search.h"
+#include "search_index.h"
+#include "autocomplete.h"
+#include "trigram.h"
+#include "concordance.h"
+#include "books.h"
+#include "pool.h"
+#include "corpus.h"
+#include "request.h"
+#include "jsonw.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define MAX_PER_PAGE 100
+
+enum search_kind { SEARCH_BOOLEAN, SEARCH_RANKED, SEARCH_FIND };
+
+// A search on its way through the worker pool, and its result.
+struct search_job {
+    enum search_kind kind;
+    char query[256]; // the pattern for SEARCH_FIND
+    int page, per_page;
+    uint32_t hits[MAX_PER_PAGE];
+    long total;
+    bool truncated;
+    char err[96];
+};
+
+static void search_work(void *arg) {
+    struct search_job *j = arg;
+    uint32_t skip = (uint32_t)(j->page - 1) * (uint32_t)j->per_page;
+    uint32_t max = (uint32_t)j->per_page;
+    switch (j->kind) {
+    case SEARCH_BOOLEAN:
+        j->total = search_query(j->query, skip, j->hits, max, &j->truncated,
+                                j->err, sizeof(j->err));
+        break;
+    case SEARCH_RANKED:
+        j->total = search_ranked(j->query, skip, j->hits, max, &j->truncated,
+                                 j->err, sizeof(j->err));
+        break;
+    case SEARCH_FIND:
+        j->total = trigram_search(j->query, skip, j->hits, max, &j->truncated,
+                                  j->err, sizeof(j->err));
+        break;
+    }
+}
+
+static void reply_search(struct mg_connection *c, const struct search_job *j) {
+    const struct corpus *cp = corpus_get();
+    uint32_t skip = (uint32_t)(j->page - 1) * (uint32_t)j->per_page, n;
+    if (j->total < 0) {
+        mg_http_reply(c, 400, "", "Invalid request: %s\n", j->err);
+        return;
+    }
+    n = j->kind == SEARCH_RANKED ? (uint32_t)j->total
+        : j->total > skip        ? (uint32_t)j->total - skip
+                                 : 0;
+    if (n > (uint32_t)j->per_page) n = (uint32_t)j->per_page;
+
+    struct jw w;
+    jw_http_begin(&w, c, 200, "Content-Type: application/json\r\n", 256 + n * 256);
+    if (j->kind == SEARCH_FIND) jw_lit(&w, "{\"pattern\":");
+    else jw_lit(&w, "{\"query\":");
+    jw_str(&w, j->query, strlen(j->query));
+    if (j->kind == SEARCH_RANKED) {
+        jw_lit(&w, ",\"ranked\":true");
+    } else {
+        jw_lit(&w, ",\"total\":");
+        jw_int(&w, j->total);
+    }
+    // A truncated search covers only the shards it had the budget for.
+    if (j->truncated) jw_lit(&w, ",\"truncated\":true");
+    jw_lit(&w, ",\"page\":");
+    jw_int(&w, j->page);
+    jw_lit(&w, ",\"per_page\":");
+    jw_int(&w, j->per_page);
+    jw_lit(&w, ",\"verses\":[");
+    // Verse fragments end in ',', so the last one is written without it.
+    for (uint32_t i = 0; i < n; ++i) {
+        size_t len;
+        const char *frag = corpus_frags(cp, CORPUS_FRAG_VERSE, j->hits[i], j->hits[i] + 1, &len);
+        jw_raw(&w, frag, i + 1 < n ? len + 1 : len);
+    }
+    jw_lit(&w, "]}");
+    if (!jw_http_end(&w, c)) mg_http_reply(c, 500, "", "Out of memory\n");
+}
+
+static void search_done(struct mg_connection *c, void *arg) {
+    if (c) reply_search(c, arg);
+    free(arg);
+}
+
+// Searches run on the worker pool, which waits out their shards so the
+// loop does not have to. Without workers they run inline.
+static void dispatch_search(struct mg_connection *c, struct search_job *j) {
+    if (pool_active()) {
+        if (pool_submit(c, search_work, search_done, j) != 0) {
+            free(j);
+            mg_http_reply(c, 503, "Retry-After: 1\r\n", "Server busy\n");
+        }
+        return;
+    }
+    search_work(j);
+    reply_search(c, j);
+    free(j);
+}
+
+struct search_req {
+    char query[256];
+    int page, per_page;
+    bool ranked;
+};
+
+static const struct req_field search_fields[] = {
+    REQ_STR_FIELD(struct search_req, query),
+    REQ_OPT_FIELD(struct search_req, page, 1, 100000),
+    REQ_OPT_FIELD(struct search_req, per_page, 1, MAX_PER_PAGE),
+    REQ_OPT_BOOL_FIELD(struct search_req, ranked),
+};
+
+void search(struct mg_connection *c, struct mg_http_message *hm) {
+    // Parse JSON body: expect {"query":"faith hope OR charity", "page":1, "per_page":20}
+    // and optionally "ranked":true for BM25 order, which omits the total.
+    struct search_req req = {.page = 1, .per_page = 20};
+    struct search_job *j;
+    char err[96];
+    if (req_decode(hm->body, search_fields, ARRAY_SIZE(search_fields), &req,
+                   err, sizeof(err)) != 0) {
+        mg_http_reply(c, 400, "", "Invalid request: %s\n", err);
+        return;
+    }
+    if (!corpus_get() || !search_index_ready()) {
+        mg_http_reply(c, 503, "", "Search unavailable\n");
+        return;
+    }
+    if ((j = calloc(1, sizeof(*j))) == NULL) {
+        mg_http_reply(c, 500, "", "Out of memory\n");
+        return;
+    }
+    j->kind = req.ranked ? SEARCH_RANKED : SEARCH_BOOLEAN;
+    memcpy(j->query, req.query, sizeof(j->query));
+    j->page = req.page;
+    j->per_page = req.per_page;
+    dispatch_search(c, j);
+}
+
+struct find_req {
+    char pattern[TRIGRAM_MAX_PATTERN + 1];
+    int page, per_page;
+};
+
+static const struct req_field find_fields[] = {
+    REQ_STR_FIELD(struct find_req, pattern),
+    REQ_OPT_FIELD(struct find_req, page, 1, 100000),
+    REQ_OPT_FIELD(struct find_req, per_page, 1, MAX_PER_PAGE),
+};
+
+void find(struct mg_connection *c, struct mg_http_message *hm) {
+    // Parse JSON body: expect {"pattern":"begat*", "page":1, "per_page":20}
+    struct find_req req = {.page = 1, .per_page = 20};
+    struct search_job *j;
+    char err[96];
+    if (req_decode(hm->body, find_fields, ARRAY_SIZE(find_fields), &req,
+                   err, sizeof(err)) != 0) {
+        mg_http_reply(c, 400, "", "Invalid request: %s\n", err);
+        return;
+    }
+    if (!corpus_get() || !trigram_ready()) {
+        mg_http_reply(c, 503, "", "Find unavailable\n");
+        return;
+    }
+    if ((j = calloc(1, sizeof(*j))) == NULL) {
+        mg_http_reply(c, 500, "", "Out of memory\n");
+        return;
+    }
+    j->kind = SEARCH_FIND;
+    memcpy(j->query, req.pattern, sizeof(req.pattern));
+    j->page = req.page;
+    j->per_page = req.per_page;
+    dispatch_search(c, j);
+}
+
+struct autocomplete_req {
+    char prefix[SEARCH_MAX_TERM + 1];
+    int limit;
+};
+
+static const struct req_field autocomplete_fields[] = {
+    REQ_STR_FIELD(struct autocomplete_req, prefix),
+    REQ_OPT_FIELD(struct autocomplete_req, limit, 1, AUTOCOMPLETE_MAX),
+};
+
+void autocomplete(struct mg_connection *c, struct mg_http_message *hm) {
+    // Parse JSON body: expect {"prefix":"beg", "limit":10}
+    struct autocomplete_req req = {.limit = 10};
+    struct autocomplete_hit hits[AUTOCOMPLETE_MAX];
+    char err[96];
+    size_t n;
+    if (req_decode(hm->body, autocomplete_fields, ARRAY_SIZE(autocomplete_fields),
+                   &req, err, sizeof(err)) != 0) {
+        mg_http_reply(c, 400, "", "Invalid request: %s\n", err);
+        return;
+    }
+    if (!search_index_ready()) {
+        mg_http_reply(c, 503, "", "Autocomplete unavailable\n");
+        return;
+    }
+
+    struct jw w;
+    jw_http_begin(&w, c, 200, "Content-Type: application/json\r\n", 1024);
+    jw_lit(&w, "{\"prefix\":");
+    jw_str(&w, req.prefix, strlen(req.prefix));
+    jw_lit(&w, ",\"books\":[");
+    n = autocomplete_books(req.prefix, hits, (size_t)req.limit);
+    for (size_t i = 0; i < n; ++i) {
+        if (i > 0) jw_lit(&w, ",");
+        jw_lit(&w, "{\"book\":");
+        jw_int(&w, (long)hits[i].id);
+        jw_lit(&w, ",\"name\":");
+        jw_str(&w, hits[i].text, strlen(hits[i].text));
+        jw_lit(&w, "}");
+    }
+    jw_lit(&w, "],\"words\":[");
+    n = autocomplete_words(req.prefix, hits, (size_t)req.limit);
+    for (size_t i = 0; i < n; ++i) {
+        if (i > 0) jw_lit(&w, ",");
+        jw_lit(&w, "{\"word\":");
+        jw_str(&w, hits[i].text, strlen(hits[i].text));
+        jw_lit(&w, ",\"count\":");
+        jw_int(&w, (long)hits[i].weight);
+        jw_lit(&w, "}");
+    }
+    jw_lit(&w, "]}");
+    if (!jw_http_end(&w, c)) mg_http_reply(c, 500, "", "Out of memory\n");
+}
+
+#define MAX_REFS 1000
+
+struct concordance_req {
+    char word[SEARCH_MAX_TERM + 1];
+    int page, per_page;
+};
+
+static const struct req_field concordance_fields[] = {
+    REQ_STR_FIELD(struct concordance_req, word),
+    REQ_OPT_FIELD(struct concordance_req, page, 1, 100000),
+    REQ_OPT_FIELD(struct concordance_req, per_page, 1, MAX_REFS),
+};
+
+void concordance(struct mg_connection *c, struct mg_http_message *hm) {
+    // Parse JSON body: expect {"word":"faith", "page":1, "per_page":100}
+    struct concordance_req req = {.page = 1, .per_page = 100};
+    struct concordance_entry e;
+    char err[96];
+    if (req_decode(hm->body, concordance_fields, ARRAY_SIZE(concordance_fields), &req,
+                   err, sizeof(err)) != 0) {
+        mg_http_reply(c, 400, "", "Invalid request: %s\n", err);
+        return;
+    }
+    const struct corpus *cp = corpus_get();
+    if (!cp || !search_index_ready()) {
+        mg_http_reply(c, 503, "", "Concordance unavailable\n");
+        return;
+    }
+    if (concordance_lookup(req.word, &e, err, sizeof(err)) != 0) {
+        mg_http_reply(c, 400, "", "Invalid request: %s\n", err);
+        return;
+    }
+    uint32_t skip = (uint32_t)(req.page - 1) * (uint32_t)req.per_page;
+    uint32_t n = e.verses > skip ? e.verses - skip : 0;
+    if (n > (uint32_t)req.per_page) n = (uint32_t)req.per_page;
+
+    struct jw w;
+    jw_http_begin(&w, c, 200, "Content-Type: application/json\r\n",
+                  256 + e.nbooks * 80 + n * 40);
+    jw_lit(&w, "{\"word\":");
+    jw_str(&w, req.word, strlen(req.word));
+    jw_lit(&w, ",\"count\":");
+    jw_int(&w, (long)e.count);
+    jw_lit(&w, ",\"verse_count\":");
+    jw_int(&w, (long)e.verses);
+    jw_lit(&w, ",\"books\":[");
+    for (uint32_t i = 0; i < e.nbooks; ++i) {
+        const char *name = book_name((int)e.books[i].book);
+        if (i > 0) jw_lit(&w, ",");
+        jw_lit(&w, "{\"book\":");
+        jw_int(&w, (long)e.books[i].book);
+        if (name) {
+            jw_lit(&w, ",\"name\":");
+            jw_str(&w, name, strlen(name));
+        }
+        jw_lit(&w, ",\"count\":");
+        jw_int(&w, (long)e.books[i].count);
+        jw_lit(&w, ",\"verse_count\":");
+        jw_int(&w, (long)e.books[i].verses);
+        jw_lit(&w, "}");
+    }
+    jw_lit(&w, "],\"page\":");
+    jw_int(&w, req.page);
+    jw_lit(&w, ",\"per_page\":");
+    jw_int(&w, req.per_page);
+    jw_lit(&w, ",\"refs\":[");
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t v = e.ordinals[skip + i];
+        if (i > 0) jw_lit(&w, ",");
+        jw_lit(&w, "{\"book\":");
+        jw_int(&w, cp->verse_book[v]);
+        jw_lit(&w, ",\"chapter\":");
+        jw_int(&w, cp->verse_chapter[v]);
+        jw_lit(&w, ",\"verse\":");
+        jw_int(&w, cp->verse_number[v]);
+        jw_lit(&w, "}");
+    }
+    jw_lit(&w, "]}");
+    if (!jw_http_end(&w, c)) mg_http_reply(c, 500, "", "Out of memory\n");
+}
@@ -0,0 +1,8 @@
+#ifndef HANDLERS_SEARCH_H
+#define HANDLERS_SEARCH_H
+#include "mongoose.h"
+void search(struct mg_connection *c, struct mg_http_message *hm);
+void find(struct mg_connection *c, struct mg_http_message *hm);
+void autocomplete(struct mg_connection *c, struct mg_http_message *hm);
+void concordance(struct mg_connection *c, struct mg_http_message *hm);
+#endif // HANDLERS_SEARCH_H
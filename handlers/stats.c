@@ -0,0 +1,117 @@
+#include "mongoose.h"
+#include "stats.h"
+#include "db.h"
+#include "chapter_cache.h"
+#include "passage_cache.h"
+#include "pool.h"
+#include "search_index.h"
+#include "trigram.h"
+#include "scan.h"
+#include "shard.h"
+#include "compress.h"
+#include "jsonw.h"
+
+void get_stats(struct mg_connection *c, struct mg_http_message *hm) {
+    (void)hm;
+    struct db_stats ds;
+    struct chapter_cache_stats cs;
+    struct passage_cache_stats ps;
+    struct pool_stats qs;
+    struct search_stats ss;
+    struct trigram_stats ts;
+    struct shard_stats hs;
+    struct compress_stats zs;
+    db_get_stats(&ds);
+    chapter_cache_get_stats(&cs);
+    passage_cache_get_stats(&ps);
+    pool_get_stats(&qs);
+    search_get_stats(&ss);
+    trigram_get_stats(&ts);
+    shard_get_stats(&hs);
+    compress_get_stats(&zs);
+
+    struct jw w;
+    jw_http_begin(&w, c, 200, "Content-Type: application/json\r\n", 1536);
+    jw_lit(&w, "{\"db\":{\"statement_reuses\":");
+    jw_int(&w, (long)ds.reuses);
+    jw_lit(&w, ",\"statement_recompiles\":");
+    jw_int(&w, (long)ds.recompiles);
+    jw_lit(&w, "},\"chapter_cache\":{\"hits\":");
+    jw_int(&w, (long)cs.hits);
+    jw_lit(&w, ",\"misses\":");
+    jw_int(&w, (long)cs.misses);
+    jw_lit(&w, ",\"evictions\":");
+    jw_int(&w, (long)cs.evictions);
+    jw_lit(&w, ",\"entries\":");
+    jw_int(&w, (long)cs.entries);
+    jw_lit(&w, ",\"bytes\":");
+    jw_int(&w, (long)cs.bytes);
+    jw_lit(&w, ",\"capacity\":");
+    jw_int(&w, (long)cs.capacity);
+    jw_lit(&w, "},\"passage_cache\":{\"hits\":");
+    jw_int(&w, (long)ps.hits);
+    jw_lit(&w, ",\"misses\":");
+    jw_int(&w, (long)ps.misses);
+    jw_lit(&w, ",\"evictions\":");
+    jw_int(&w, (long)ps.evictions);
+    jw_lit(&w, ",\"rejections\":");
+    jw_int(&w, (long)ps.rejections);
+    jw_lit(&w, ",\"entries\":");
+    jw_int(&w, (long)ps.entries);
+    jw_lit(&w, ",\"bytes\":");
+    jw_int(&w, (long)ps.bytes);
+    jw_lit(&w, ",\"capacity\":");
+    jw_int(&w, (long)ps.capacity);
+    jw_lit(&w, "},\"pool\":{\"threads\":");
+    jw_int(&w, (long)qs.threads);
+    jw_lit(&w, ",\"queue_depth\":");
+    jw_int(&w, (long)qs.queue_depth);
+    jw_lit(&w, ",\"queued\":");
+    jw_int(&w, (long)qs.queued);
+    jw_lit(&w, ",\"submitted\":");
+    jw_int(&w, (long)qs.submitted);
+    jw_lit(&w, ",\"completed\":");
+    jw_int(&w, (long)qs.completed);
+    jw_lit(&w, ",\"rejected\":");
+    jw_int(&w, (long)qs.rejected);
+    jw_lit(&w, ",\"orphaned\":");
+    jw_int(&w, (long)qs.orphaned);
+    jw_lit(&w, "},\"search\":{\"terms\":");
+    jw_int(&w, (long)ss.terms);
+    jw_lit(&w, ",\"postings\":");
+    jw_int(&w, (long)ss.postings);
+    jw_lit(&w, ",\"bytes\":");
+    jw_int(&w, (long)ss.bytes);
+    jw_lit(&w, "},\"trigram\":{\"grams\":");
+    jw_int(&w, (long)ts.grams);
+    jw_lit(&w, ",\"postings\":");
+    jw_int(&w, (long)ts.postings);
+    jw_lit(&w, ",\"bytes\":");
+    jw_int(&w, (long)ts.bytes);
+    jw_lit(&w, ",\"scan_engine\":");
+    jw_str(&w, scan_engine(), strlen(scan_engine()));
+    jw_lit(&w, "},\"shards\":{\"threads\":");
+    jw_int(&w, (long)hs.threads);
+    jw_lit(&w, ",\"shards\":");
+    jw_int(&w, (long)hs.shards);
+    jw_lit(&w, ",\"queries\":");
+    jw_int(&w, (long)hs.queries);
+    jw_lit(&w, ",\"tasks\":");
+    jw_int(&w, (long)hs.tasks);
+    jw_lit(&w, ",\"steals\":");
+    jw_int(&w, (long)hs.steals);
+    jw_lit(&w, ",\"skipped\":");
+    jw_int(&w, (long)hs.skipped);
+    jw_lit(&w, "},\"compress\":{\"bodies\":");
+    jw_int(&w, (long)zs.bodies);
+    jw_lit(&w, ",\"bytes_in\":");
+    jw_int(&w, (long)zs.bytes_in);
+    jw_lit(&w, ",\"bytes_out\":");
+    jw_int(&w, (long)zs.bytes_out);
+    jw_lit(&w, ",\"gzip_replies\":");
+    jw_int(&w, (long)zs.gzip);
+    jw_lit(&w, ",\"deflate_replies\":");
+    jw_int(&w, (long)zs.deflate);
+    jw_lit(&w, "}}");
+    if (!jw_http_end(&w, c)) mg_http_reply(c, 500, "", "Out of memory\n");
+}
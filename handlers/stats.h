@@ -0,0 +1,5 @@
+#ifndef HANDLERS_STATS_H
+#define HANDLERS_STATS_H
+#include "mongoose.h"
+void get_stats(struct mg_connection *c, struct mg_http_message *hm);
+#endif // HANDLERS_STATS_H
@@ -0,0 +1,167 @@
+#include "jsonw.h"
+
+// Non-zero for bytes that cannot appear unescaped in a JSON string.
+static const unsigned char needs_escape[256] = {
+    [0 ... 0x1f] = 1, ['"'] = 1, ['\\'] = 1,
+};
+
+static size_t escape_char(char *d, unsigned char ch) {
+    static const char hex[] = "0123456789abcdef";
+    d[0] = '\\';
+    switch (ch) {
+    case '"': d[1] = '"'; return 2;
+    case '\\': d[1] = '\\'; return 2;
+    case '\b': d[1] = 'b'; return 2;
+    case '\f': d[1] = 'f'; return 2;
+    case '\n': d[1] = 'n'; return 2;
+    case '\r': d[1] = 'r'; return 2;
+    case '\t': d[1] = 't'; return 2;
+    default:
+        memcpy(d + 1, "u00", 3);
+        d[4] = hex[ch >> 4];
+        d[5] = hex[ch & 15];
+        return 6;
+    }
+}
+
+bool jw_reserve(struct jw *w, size_t n) {
+    struct mg_iobuf *io = w->io;
+    if (w->failed) return false;
+    if (io->size - io->len >= n) return true;
+    size_t want = io->size * 2;
+    if (want < io->len + n) want = io->len + n;
+    if (!mg_iobuf_resize(io, want)) {
+        w->failed = true;
+        return false;
+    }
+    return true;
+}
+
+void jw_raw(struct jw *w, const void *p, size_t n) {
+    if (n == 0 || !jw_reserve(w, n)) return;
+    memcpy(w->io->buf + w->io->len, p, n);
+    w->io->len += n;
+}
+
+void jw_str(struct jw *w, const char *s, size_t n) {
+    size_t i = 0;
+    // Room for the common case of little or nothing to escape.
+    if (!jw_reserve(w, n + 2)) return;
+    w->io->buf[w->io->len++] = '"';
+    while (i < n) {
+        size_t j = i;
+        while (j < n && !needs_escape[(unsigned char)s[j]]) j++;
+        jw_raw(w, s + i, j - i);
+        if (j == n || !jw_reserve(w, 6 + 1)) break;
+        w->io->len += escape_char((char *)w->io->buf + w->io->len, (unsigned char)s[j]);
+        i = j + 1;
+    }
+    jw_raw(w, "\"", 1);
+}
+
+void jw_int(struct jw *w, long v) {
+    char buf[24], *p = buf + sizeof(buf);
+    unsigned long u = v < 0 ? 0UL - (unsigned long)v : (unsigned long)v;
+    do *--p = (char)('0' + u % 10); while ((u /= 10) != 0);
+    if (v < 0) *--p = '-';
+    jw_raw(w, p, (size_t)(buf + sizeof(buf) - p));
+}
+
+void jw_init(struct jw *w, struct mg_iobuf *io, size_t hint) {
+    w->io = io;
+    w->c = NULL;
+    w->start = w->body = io->len;
+    w->clen = 0;
+    w->ref = 0;
+    w->failed = false;
+    if (hint) jw_reserve(w, hint);
+}
+
+// Reason phrases for the statuses handlers send; mongoose keeps its own
+// table private.
+static const char *status_text(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+    }
+}
+
+void jw_http_begin(struct jw *w, struct mg_connection *c, int status,
+                   const char *headers, size_t hint) {
+    char head[64];
+    jw_init(w, &c->send, 0);
+    w->c = c;
+    int n = (int)mg_snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\n", status,
+                             status_text(status));
+    size_t hl = headers ? strlen(headers) : 0;
+    // Size the buffer once for head and body.
+    jw_reserve(w, (size_t)n + hl + 36 + hint);
+    jw_raw(w, head, (size_t)n);
+    jw_raw(w, headers, hl);
+    jw_lit(w, "Content-Length: ");
+    w->clen = w->io->len;
+    jw_lit(w, "          \r\n\r\n");
+    w->body = w->io->len;
+}
+
+bool jw_http_end(struct jw *w, struct mg_connection *c) {
+    if (w->failed) {
+        jw_abort(w);
+        return false;
+    }
+    char digits[11];
+    size_t n = mg_snprintf(digits, sizeof(digits), "%lu",
+                           (unsigned long)(w->io->len - w->body + w->ref));
+    memcpy(w->io->buf + w->clen, digits, n);
+    c->is_resp = 0;
+    return true;
+}
+
+static void release_rbuf(void *arg) {
+    rbuf_unref(arg);
+}
+
+void jw_ref(struct jw *w, struct rbuf *b, const char *p, size_t n) {
+    struct mg_connection *c = w->c;
+    if (n < JW_REF_MIN || c == NULL) {
+        jw_raw(w, p, n);
+        return;
+    }
+    if (w->failed) return;
+    size_t before = c->send.len;
+    if (!mg_send_ref(c, p, n, b ? release_rbuf : NULL, b ? rbuf_ref(b) : NULL)) {
+        w->failed = true;
+        return;
+    }
+    // mg_send_ref copies where it cannot queue, and Content-Length already
+    // counts bytes copied into c->send.
+    if (c->send.len == before) w->ref += n;
+}
+
+void jw_abort(struct jw *w) {
+    if (w->c) mg_send_truncate(w->c, w->start);
+    else w->io->len = w->start;
+    w->ref = 0;
+    w->failed = false;
+}
+
+char *jw_detach(struct jw *w, size_t *len) {
+    char *p;
+    jw_raw(w, "", 1);
+    if (w->failed) {
+        mg_iobuf_free(w->io);
+        return NULL;
+    }
+    p = (char *)w->io->buf;
+    if (len) *len = w->io->len - 1;
+    // The iobuf was allocated with mg_calloc, which is calloc here, so the
+    // caller may release it with free().
+    w->io->buf = NULL;
+    w->io->len = w->io->size = 0;
+    return p;
+}
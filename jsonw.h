@@ -0,0 +1,53 @@
+#ifndef JSONW_H
+#define JSONW_H
+#include "mongoose.h"
+#include "rbuf.h"
+
+// Streaming JSON writer that appends straight to a mongoose iobuf, usually
+// c->send, so a response is rendered in place instead of being built as a
+// cJSON tree, printed to a string and copied again by mg_http_reply.
+struct jw {
+    struct mg_iobuf *io;
+    struct mg_connection *c; // whose c->send io is, for HTTP responses
+    size_t start; // io->len when the writer began; jw_abort rewinds to it
+    size_t clen;  // offset of the Content-Length digits, 0 for a bare body
+    size_t body;  // offset of the first body byte
+    size_t ref;   // body bytes queued by reference with jw_ref
+    bool failed;  // an allocation failed and the output is incomplete
+};
+
+// Starts a bare JSON document in io, reserving hint bytes up front.
+void jw_init(struct jw *w, struct mg_iobuf *io, size_t hint);
+
+// Starts an HTTP response on c with a Content-Length placeholder that
+// jw_http_end patches once the body is complete.
+void jw_http_begin(struct jw *w, struct mg_connection *c, int status,
+                   const char *headers, size_t hint);
+// Completes the response. Returns false, after discarding everything the
+// writer appended, if an allocation failed along the way.
+bool jw_http_end(struct jw *w, struct mg_connection *c);
+
+// Discards everything appended since jw_init or jw_http_begin, references
+// queued by jw_ref included.
+void jw_abort(struct jw *w);
+
+// Makes room for n more bytes. Returns false and marks w failed otherwise.
+bool jw_reserve(struct jw *w, size_t n);
+void jw_raw(struct jw *w, const void *p, size_t n);
+// Appends n bytes at p, which b holds, to the body of an HTTP response; a
+// NULL b means they outlive the connection, like the corpus. From
+// JW_REF_MIN bytes on they are not copied but queued by reference, keeping
+// b alive until they are sent.
+#define JW_REF_MIN 2048
+void jw_ref(struct jw *w, struct rbuf *b, const char *p, size_t n);
+#define jw_lit(w, s) jw_raw((w), (s), sizeof(s) - 1)
+// Appends s as a quoted JSON string, escaped the way cJSON does: quote,
+// backslash and control characters are escaped, everything else is copied
+// in runs.
+void jw_str(struct jw *w, const char *s, size_t n);
+void jw_int(struct jw *w, long v);
+
+// NUL-terminates a bare document and hands its malloc'd buffer over, leaving
+// io empty. Returns NULL if the writer failed.
+char *jw_detach(struct jw *w, size_t *len);
+#endif // JSONW_H
@@ -4660,6 +4660,12 @@ void mg_close_conn(struct mg_connection *c) {
   MG_PROF_FREE(c);
 
   mg_tls_free(c);
+  while (c->sendref != NULL) {
+    struct mg_sendref *r = c->sendref;
+    c->sendref = r->next;
+    if (r->release != NULL) r->release(r->release_arg);
+    mg_free(r);
+  }
   mg_iobuf_free(&c->recv);
   mg_iobuf_free(&c->send);
   mg_iobuf_free(&c->rtls);
@@ -7003,6 +7009,18 @@ bool mg_send(struct mg_connection *c, const void *buf, size_t len) {
   return res;
 }
 
+// The builtin stack has no scatter-gather send, so buffers are copied
+bool mg_send_ref(struct mg_connection *c, const void *buf, size_t len,
+                 void (*release)(void *), void *release_arg) {
+  bool res = mg_send(c, buf, len);
+  if (release != NULL) release(release_arg);
+  return res;
+}
+
+void mg_send_truncate(struct mg_connection *c, size_t len) {
+  if (len < c->send.len) c->send.len = len;
+}
+
 uint8_t mcast_addr[6] = {0x01, 0x00, 0x5e, 0x00, 0x00, 0xfb};
 void mg_multicast_add(struct mg_connection *c, char *ip) {
   (void) ip;  // ip4/6_mcastmac(mcast_mac, &ip); ipv6 param
@@ -10412,6 +10430,54 @@ long mg_io_send(struct mg_connection *c, const void *buf, size_t len) {
   return n;
 }
 
+// Queues len bytes at buf after what c->send holds, without copying them.
+// They must stay unchanged until release(release_arg) is called, once they
+// are sent or c closes. Falls back to copying, and releases at once, where
+// they cannot be sent with a single sendmsg() next to c->send.
+bool mg_send_ref(struct mg_connection *c, const void *buf, size_t len,
+                 void (*release)(void *), void *release_arg) {
+  struct mg_sendref *r = NULL, **p = &c->sendref;
+  size_t gap = c->send.len;
+#if MG_ARCH == MG_ARCH_UNIX
+  if (!c->is_udp && !c->is_tls && len > 0) {
+    r = (struct mg_sendref *) mg_calloc(1, sizeof(*r));
+  }
+#endif
+  if (r == NULL) {
+    bool ok = mg_send(c, buf, len);
+    if (release != NULL) release(release_arg);
+    return ok;
+  }
+  for (; *p != NULL; p = &(*p)->next) gap -= (*p)->gap;
+  r->gap = gap;
+  r->buf = (const char *) buf;
+  r->len = len;
+  r->release = release;
+  r->release_arg = release_arg;
+  *p = r;
+  return true;
+}
+
+// Cuts c->send down to len bytes, releasing the buffers queued by
+// mg_send_ref() after those, i.e. while c->send held more than len bytes.
+// Nothing may have been sent since c->send held len bytes.
+void mg_send_truncate(struct mg_connection *c, size_t len) {
+  struct mg_sendref **p = &c->sendref;
+  size_t ofs = 0;
+  if (len >= c->send.len) return;
+  while (*p != NULL && ofs + (*p)->gap <= len) {
+    ofs += (*p)->gap;
+    p = &(*p)->next;
+  }
+  while (*p != NULL) {
+    struct mg_sendref *r = *p;
+    *p = r->next;
+    if (r->release != NULL) r->release(r->release_arg);
+    mg_free(r);
+  }
+  c->send.len = len;
+}
+
 bool mg_send(struct mg_connection *c, const void *buf, size_t len) {
   if (c->is_udp) {
     long n = mg_io_send(c, buf, len);
@@ -10518,6 +10584,14 @@ bool mg_open_listener(struct mg_connection *c, const char *url) {
       // won't work! (setsockopt will return EINVAL)
       MG_ERROR(("setsockopt(SO_REUSEADDR): %d", MG_SOCK_ERR(rc)));
 #endif
+#if defined(SO_REUSEPORT)
+      // Lets several event loops listen on one port; the kernel spreads
+      // incoming connections across them.
+    } else if (c->mgr->reuseport &&
+               (rc = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (char *) &on,
+                                sizeof(on))) != 0) {
+      MG_ERROR(("setsockopt(SO_REUSEPORT): %d", MG_SOCK_ERR(rc)));
+#endif
 #if MG_IPV6_V6ONLY
       // Bind only to the V6 address, not V4 address on this port
     } else if (c->loc.is_ip6 &&
@@ -10616,10 +10690,78 @@ static void read_conn(struct mg_connection *c) {
   }
 }
 
+#if MG_ARCH == MG_ARCH_UNIX
+#ifndef MG_SENDREF_IOV
+#define MG_SENDREF_IOV 16
+#endif
+
+// Sends c->send with the buffers of c->sendref in between, in one call
+static long mg_io_sendref(struct mg_connection *c) {
+  struct iovec iov[MG_SENDREF_IOV];
+  struct msghdr msg;
+  struct mg_sendref *r;
+  size_t ofs = 0;
+  int n = 0;
+  long res;
+  for (r = c->sendref; r != NULL && n + 2 <= MG_SENDREF_IOV; r = r->next) {
+    if (r->gap > 0) {
+      iov[n].iov_base = c->send.buf + ofs, iov[n++].iov_len = r->gap;
+      ofs += r->gap;
+    }
+    iov[n].iov_base = (void *) r->buf, iov[n++].iov_len = r->len;
+  }
+  if (r == NULL && ofs < c->send.len) {
+    iov[n].iov_base = c->send.buf + ofs, iov[n++].iov_len = c->send.len - ofs;
+  }
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = (size_t) n;
+  res = (long) sendmsg(FD(c), &msg, MSG_NONBLOCKING);
+  MG_VERBOSE(("%lu %ld %d", c->id, res, MG_SOCK_ERR(res)));
+  if (MG_SOCK_PENDING(res)) return MG_IO_WAIT;
+  if (MG_SOCK_RESET(res)) return MG_IO_RESET;
+  if (res <= 0) return MG_IO_ERR;
+  return res;
+}
+
+// Drops the first n sent bytes of c->send and c->sendref
+static void mg_sendref_del(struct mg_connection *c, size_t n) {
+  struct mg_sendref *r;
+  size_t del = 0, k;
+  while ((r = c->sendref) != NULL) {
+    k = n < r->gap ? n : r->gap;
+    r->gap -= k, del += k, n -= k;
+    if (r->gap > 0) break;
+    k = n < r->len ? n : r->len;
+    r->buf += k, r->len -= k, n -= k;
+    if (r->len > 0) break;
+    c->sendref = r->next;
+    if (r->release != NULL) r->release(r->release_arg);
+    mg_free(r);
+  }
+  mg_iobuf_del(&c->send, 0, del + n);
+}
+#endif
+
 static void write_conn(struct mg_connection *c) {
   char *buf = (char *) c->send.buf;
   size_t len = c->send.len;
-  long n = c->is_tls ? mg_tls_send(c, buf, len) : mg_io_send(c, buf, len);
+  long n;
+#if MG_ARCH == MG_ARCH_UNIX
+  if (c->sendref != NULL) {
+    n = mg_io_sendref(c);
+    if (n == MG_IO_WAIT) return;
+    if (n <= 0) {
+      c->is_closing = 1;
+      return;
+    }
+    mg_sendref_del(c, (size_t) n);
+    if (c->send.len == 0 && c->sendref == NULL) MG_EPOLL_MOD(c, 0);
+    mg_call(c, MG_EV_WRITE, &n);
+    return;
+  }
+#endif
+  n = c->is_tls ? mg_tls_send(c, buf, len) : mg_io_send(c, buf, len);
   // TODO(): mg_tls_send() may return 0 forever on steady OOM
   MG_DEBUG(("%lu %ld snd %ld/%ld rcv %ld/%ld n=%ld err=%d", c->id, c->fd,
             (long) c->send.len, (long) c->send.size, (long) c->recv.len,
@@ -10773,7 +10915,8 @@ static bool can_read(const struct mg_connection *c) {
 }
 
 static bool can_write(const struct mg_connection *c) {
-  return c->is_connecting || (c->send.len > 0 && c->is_tls_hs == 0);
+  return c->is_connecting ||
+         ((c->send.len > 0 || c->sendref != NULL) && c->is_tls_hs == 0);
 }
 
 static bool skip_iotest(const struct mg_connection *c) {
@@ -11038,7 +11181,9 @@ void mg_mgr_poll(struct mg_mgr *mgr, int ms) {
       if (c->is_tls && !c->is_tls_hs && c->send.len == 0) mg_tls_flush(c);
     }
 
-    if (c->is_draining && c->send.len == 0) c->is_closing = 1;
+    if (c->is_draining && c->send.len == 0 && c->sendref == NULL) {
+      c->is_closing = 1;
+    }
     if (c->is_closing) close_conn(c);
   }
 }
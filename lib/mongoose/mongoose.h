@@ -1706,11 +1706,22 @@ struct mg_mgr {
   struct mg_tcpip_if *ifp;      // Builtin TCP/IP stack only. Interface pointer
   size_t extraconnsize;         // Builtin TCP/IP stack only. Extra space
   MG_SOCKET_TYPE pipe;          // Socketpair end for mg_wakeup()
+  bool reuseport;               // Set SO_REUSEPORT on listening sockets
 #if MG_ENABLE_FREERTOS_TCP
   SocketSet_t ss;  // NOTE(lsm): referenced from socket struct
 #endif
 };
 
+// A buffer queued by mg_send_ref(), sent after gap more bytes of c->send
+struct mg_sendref {
+  struct mg_sendref *next;    // Next buffer, queued later
+  size_t gap;                 // Bytes of c->send to send before this one
+  const char *buf;            // Bytes still to send
+  size_t len;                 // Their number
+  void (*release)(void *);    // Called once sent, or when c closes
+  void *release_arg;          // Its argument
+};
+
 struct mg_connection {
   struct mg_connection *next;     // Linkage in struct mg_mgr :: connections
   struct mg_mgr *mgr;             // Our container
@@ -1720,6 +1731,7 @@ struct mg_connection {
   unsigned long id;               // Auto-incrementing unique connection ID
   struct mg_iobuf recv;           // Incoming data
   struct mg_iobuf send;           // Outgoing data
+  struct mg_sendref *sendref;     // Outgoing buffers not copied into send
   struct mg_iobuf prof;           // Profile data enabled by MG_ENABLE_PROFILE
   struct mg_iobuf rtls;           // TLS only. Incoming encrypted data
   mg_event_handler_t fn;          // User-specified event handler function
@@ -1761,6 +1773,9 @@ struct mg_connection *mg_wrapfd(struct mg_mgr *mgr, int fd,
                                 mg_event_handler_t fn, void *fn_data);
 void mg_connect_resolved(struct mg_connection *);
 bool mg_send(struct mg_connection *, const void *, size_t);
+bool mg_send_ref(struct mg_connection *, const void *, size_t,
+                 void (*release)(void *), void *release_arg);
+void mg_send_truncate(struct mg_connection *, size_t len);
 size_t mg_printf(struct mg_connection *, const char *fmt, ...);
 size_t mg_vprintf(struct mg_connection *, const char *fmt, va_list *ap);
 bool mg_aton(struct mg_str str, struct mg_addr *addr);
@@ -1,20 +1,162 @@
+#define _GNU_SOURCE // pthread_setaffinity_np
 #include "mongoose.h"
 #include "router.h"
+#include "db.h"
+#include "corpus.h"
+#include "chapter_cache.h"
+#include "passage_cache.h"
+#include "kjv.h"
+#include "pool.h"
+#include "search_index.h"
+#include "autocomplete.h"
+#include "concordance.h"
+#include "trigram.h"
+#include "scan.h"
+#include "shard.h"
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+
+#define DB_PATH "db.db"
+#define CORPUS_PATH "kjv.corpus"
+#define LISTEN_URL "http://0.0.0.0:8000"
+
+static int nloops = 1, pin_loops = 0;
+static struct mg_mgr *mgrs; // one per event loop
+static volatile sig_atomic_t stopping; // set on SIGINT or SIGTERM
+
+static void stop(int sig) {
+    (void) sig;
+    stopping = 1;
+}
 
 static void fn(struct mg_connection *c, int ev, void *ev_data) {
     if (ev == MG_EV_HTTP_MSG) {
         struct mg_http_message *hm = (struct mg_http_message *) ev_data;
         route_request(c, hm);
+    } else if (ev == MG_EV_WAKEUP) {
+        pool_wakeup(c, (struct mg_str *) ev_data);
+    } else if (ev == MG_EV_CLOSE) {
+        pool_cancel(c);
+    }
+}
+
+// Runs one event loop with its own listener. With several loops every
+// listener sets SO_REUSEPORT so the kernel balances accepts across them;
+// the corpus, caches and worker pool are shared. The loop's manager
+// outlives it: main frees it once the pool can no longer wake it.
+static void *serve(void *arg) {
+    long index = (long) arg, ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    struct mg_mgr *mgr = &mgrs[index];
+
+    if (pin_loops) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET((int) (index % (ncpu > 0 ? ncpu : 1)), &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            fprintf(stderr, "loop %ld: cannot pin to a CPU\n", index);
     }
+    mg_mgr_init(mgr);
+    mgr->reuseport = nloops > 1;
+    mg_wakeup_init(mgr);
+    if (mg_http_listen(mgr, LISTEN_URL, fn, NULL) == NULL) {
+        fprintf(stderr, "loop %ld: cannot listen on %s\n", index, LISTEN_URL);
+        exit(1);
+    }
+    // A loop the signal did not interrupt notices within one poll.
+    while (!stopping) mg_mgr_poll(mgr, 1000);
+    db_close();
+    return NULL;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-w] [-m MiB] [-p MiB] [-t N] [-q N] [-n N] [-a] [-s N]\n"
+            "  -w      render every chapter into the cache at startup\n"
+            "  -m MiB  chapter cache capacity (default 64)\n"
+            "  -p MiB  passage cache capacity (default 32)\n"
+            "  -t N    worker threads for SQLite queries, 0 runs them inline (default 4)\n"
+            "  -q N    worker queue depth (default 256)\n"
+            "  -n N    event loops, each with its own listener (default 1)\n"
+            "  -a      pin event loop i to CPU i\n"
+            "  -s N    search threads, 0 runs searches unsplit (default: one per CPU)\n",
+            prog);
 }
 
-int main(void) {
-    struct mg_mgr mgr;
+int main(int argc, char *argv[]) {
+    const struct corpus *cp;
+    size_t cache_mb = 64, passage_mb = 32;
+    int opt, warm = 0, workers = 4, queue_depth = 256;
+    int searchers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    while ((opt = getopt(argc, argv, "wm:p:t:q:n:as:")) != -1) {
+        switch (opt) {
+        case 'w': warm = 1; break;
+        case 'm': cache_mb = strtoul(optarg, NULL, 10); break;
+        case 'p': passage_mb = strtoul(optarg, NULL, 10); break;
+        case 't': workers = atoi(optarg); break;
+        case 'q': queue_depth = atoi(optarg); break;
+        case 'n': nloops = atoi(optarg); break;
+        case 'a': pin_loops = 1; break;
+        case 's': searchers = atoi(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (nloops < 1 || searchers < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
     mg_log_set(MG_LL_DEBUG);
-    mg_mgr_init(&mgr);
-    mg_http_listen(&mgr, "http://0.0.0.0:8000", fn, NULL);
-    printf("Server started on http://localhost:8000\n");
-    for (;;) mg_mgr_poll(&mgr, 1000);
-    mg_mgr_free(&mgr);
+    scan_init();
+    if (db_open(DB_PATH) != 0) return 1;
+    if (corpus_map(CORPUS_PATH) != 0 && corpus_load_sqlite(DB_PATH) != 0)
+        fprintf(stderr, "corpus unavailable, serving from SQLite\n");
+    if ((cp = corpus_get()) != NULL) {
+        if (chapter_cache_init(cp->nchapters, cache_mb << 20) != 0) return 1;
+        if (warm) kjv_warm_cache();
+        if (search_index_build(cp) != 0 || autocomplete_build(cp) != 0 ||
+            concordance_build(cp) != 0 || trigram_build(cp) != 0 ||
+            shard_init(cp, searchers) != 0)
+            return 1;
+    }
+    if (passage_cache_init(passage_mb << 20) != 0) return 1;
+    if (router_init() != 0) return 1;
+    if (workers > 0 && pool_init(workers, queue_depth) != 0) return 1;
+
+    struct sigaction sa = {.sa_handler = stop};
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    pthread_t *loops = calloc((size_t) nloops, sizeof(*loops));
+    mgrs = calloc((size_t) nloops, sizeof(*mgrs));
+    if (!loops || !mgrs) return 1;
+    for (long i = 1; i < nloops; ++i) {
+        if (pthread_create(&loops[i], NULL, serve, (void *) i) != 0) {
+            fprintf(stderr, "cannot start event loop %ld\n", i);
+            return 1;
+        }
+    }
+    printf("Server started on http://localhost:8000 with %d event loop%s\n",
+           nloops, nloops == 1 ? "" : "s");
+    serve((void *) 0);
+
+    for (long i = 1; i < nloops; ++i) pthread_join(loops[i], NULL);
+    free(loops);
+    // Workers finishing a job wake its loop's manager, so the pool drains
+    // before any manager is freed.
+    pool_shutdown();
+    for (int i = 0; i < nloops; ++i) mg_mgr_free(&mgrs[i]);
+    free(mgrs);
+    router_free();
+    shard_shutdown();
+    trigram_free();
+    concordance_free();
+    autocomplete_free();
+    search_index_free();
+    passage_cache_free();
+    chapter_cache_free();
+    corpus_free();
     return 0;
-}
\ No newline at end of file
+}
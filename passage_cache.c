@@ -0,0 +1,209 @@
+#include "passage_cache.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SKETCH_DEPTH 4
+#define SKETCH_MAX 15 // counters saturate like 4-bit TinyLFU counters
+
+struct entry {
+    struct passage_key key;
+    uint64_t hash;
+    struct rbuf *body;
+    struct entry *prev, *next; // LRU list, head is most recent
+    struct entry *chain;       // bucket chain
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct entry **buckets;
+static size_t nbuckets; // power of two
+static struct entry *lru_head, *lru_tail;
+
+// Count-min sketch of key frequencies, halved every `sample` increments so
+// that old popularity fades.
+static uint8_t *sketch;
+static size_t sketch_width; // power of two
+static size_t sketch_adds, sketch_sample;
+
+static struct passage_cache_stats stats;
+
+static uint64_t key_hash(const struct passage_key *k) {
+    uint64_t h = 0x9e3779b97f4a7c15ull;
+    const int v[6] = {k->book, k->start_chapter, k->start_verse,
+                      k->end_book, k->end_chapter, k->end_verse};
+    for (int i = 0; i < 6; ++i) {
+        h ^= (uint32_t)v[i];
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+    }
+    return h;
+}
+
+static size_t sketch_index(uint64_t hash, int row) {
+    uint64_t h = hash + (uint64_t)row * ((hash >> 32) | 1);
+    h ^= h >> 29;
+    return (size_t)row * sketch_width + (size_t)(h & (sketch_width - 1));
+}
+
+static unsigned sketch_estimate(uint64_t hash) {
+    unsigned est = SKETCH_MAX;
+    for (int r = 0; r < SKETCH_DEPTH; ++r) {
+        unsigned v = sketch[sketch_index(hash, r)];
+        if (v < est) est = v;
+    }
+    return est;
+}
+
+static void sketch_add(uint64_t hash) {
+    for (int r = 0; r < SKETCH_DEPTH; ++r) {
+        uint8_t *v = &sketch[sketch_index(hash, r)];
+        if (*v < SKETCH_MAX) (*v)++;
+    }
+    if (++sketch_adds >= sketch_sample) {
+        for (size_t i = 0; i < SKETCH_DEPTH * sketch_width; ++i) sketch[i] >>= 1;
+        sketch_adds /= 2;
+    }
+}
+
+static size_t pow2_at_least(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+int passage_cache_init(size_t max_bytes) {
+    passage_cache_free();
+    // Size for entries of a few KiB, which is typical for passages.
+    size_t expected = max_bytes / 4096;
+    if (expected < 1024) expected = 1024;
+    if (expected > (1u << 20)) expected = 1u << 20;
+    nbuckets = pow2_at_least(expected);
+    sketch_width = pow2_at_least(expected);
+    sketch_sample = 10 * sketch_width;
+    buckets = calloc(nbuckets, sizeof(*buckets));
+    sketch = calloc(SKETCH_DEPTH * sketch_width, 1);
+    if (!buckets || !sketch) {
+        passage_cache_free();
+        return -1;
+    }
+    stats.capacity = max_bytes;
+    return 0;
+}
+
+void passage_cache_free(void) {
+    for (struct entry *e = lru_head, *next; e; e = next) {
+        next = e->next;
+        rbuf_unref(e->body);
+        free(e);
+    }
+    free(buckets);
+    free(sketch);
+    buckets = NULL;
+    sketch = NULL;
+    lru_head = lru_tail = NULL;
+    nbuckets = sketch_width = sketch_adds = sketch_sample = 0;
+    stats = (struct passage_cache_stats){0};
+}
+
+static struct entry **find(const struct passage_key *k, uint64_t hash) {
+    struct entry **pe = &buckets[hash & (nbuckets - 1)];
+    while (*pe && ((*pe)->hash != hash || memcmp(&(*pe)->key, k, sizeof(*k)) != 0))
+        pe = &(*pe)->chain;
+    return pe;
+}
+
+static void lru_unlink(struct entry *e) {
+    if (e->prev) e->prev->next = e->next;
+    else lru_head = e->next;
+    if (e->next) e->next->prev = e->prev;
+    else lru_tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void lru_push_front(struct entry *e) {
+    e->prev = NULL;
+    e->next = lru_head;
+    if (lru_head) lru_head->prev = e;
+    lru_head = e;
+    if (!lru_tail) lru_tail = e;
+}
+
+static void evict(struct entry *e) {
+    struct entry **pe = find(&e->key, e->hash);
+    *pe = e->chain;
+    lru_unlink(e);
+    stats.bytes -= rbuf_size(e->body);
+    stats.entries--;
+    stats.evictions++;
+    rbuf_unref(e->body);
+    free(e);
+}
+
+struct rbuf *passage_cache_get(const struct passage_key *k) {
+    struct rbuf *b = NULL;
+    uint64_t hash = key_hash(k);
+    pthread_mutex_lock(&lock);
+    if (buckets) {
+        struct entry *e = *find(k, hash);
+        sketch_add(hash);
+        if (e) {
+            stats.hits++;
+            lru_unlink(e);
+            lru_push_front(e);
+            b = rbuf_ref(e->body);
+        } else {
+            stats.misses++;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return b;
+}
+
+int passage_cache_put(const struct passage_key *k, struct rbuf *body) {
+    uint64_t hash = key_hash(k);
+    size_t len = rbuf_size(body);
+    int rc = -1;
+    pthread_mutex_lock(&lock);
+    if (!buckets) goto done;
+    if (len > stats.capacity) goto reject;
+    struct entry **pe = find(k, hash);
+    if (*pe) goto done;
+
+    // Admit only if the candidate is more popular than every LRU entry it
+    // would displace.
+    unsigned freq = sketch_estimate(hash);
+    size_t freed = 0;
+    for (struct entry *v = lru_tail; stats.bytes - freed + len > stats.capacity;
+         v = v->prev) {
+        if (sketch_estimate(v->hash) >= freq) goto reject;
+        freed += rbuf_size(v->body);
+    }
+    while (stats.bytes + len > stats.capacity) evict(lru_tail);
+
+    struct entry *e = calloc(1, sizeof(*e));
+    if (!e) goto done;
+    e->key = *k;
+    e->hash = hash;
+    e->body = rbuf_ref(body);
+    pe = find(k, hash); // evictions may have relinked the chain
+    e->chain = *pe;
+    *pe = e;
+    lru_push_front(e);
+    stats.bytes += len;
+    stats.entries++;
+    rc = 0;
+    goto done;
+
+reject:
+    stats.rejections++;
+done:
+    pthread_mutex_unlock(&lock);
+    return rc;
+}
+
+void passage_cache_get_stats(struct passage_cache_stats *out) {
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,36 @@
+#ifndef PASSAGE_CACHE_H
+#define PASSAGE_CACHE_H
+#include <stddef.h>
+#include "rbuf.h"
+
+// Byte-bounded LRU cache of rendered get_passage bodies with TinyLFU
+// admission: a new entry only displaces the LRU victims when a count-min
+// sketch of recent lookups says it is requested more often than they are,
+// so a large one-off range cannot flush the hot set. All functions are
+// safe to call from any event loop thread.
+// A passage runs from (book, start_chapter, start_verse) through
+// (end_book, end_chapter, end_verse), both inclusive.
+struct passage_key {
+    int book, start_chapter, start_verse, end_book, end_chapter, end_verse;
+};
+
+struct passage_cache_stats {
+    unsigned long hits, misses, evictions, rejections;
+    size_t entries, bytes, capacity;
+};
+
+// Returns 0 on success, -1 on allocation failure.
+int passage_cache_init(size_t max_bytes);
+void passage_cache_free(void);
+
+// Returns a new reference to the cached body for k, or NULL on a miss.
+// Every call also counts towards k's admission frequency. Release the
+// result with rbuf_unref.
+struct rbuf *passage_cache_get(const struct passage_key *k);
+
+// Offers body for k. Returns 0 if it was admitted, in which case the cache
+// holds a reference of its own, or -1 if k is cached or was not admitted.
+int passage_cache_put(const struct passage_key *k, struct rbuf *body);
+
+void passage_cache_get_stats(struct passage_cache_stats *out);
+#endif // PASSAGE_CACHE_H
@@ -0,0 +1,186 @@
+#include "pool.h"
+#include "db.h"
+#include <pthread.h>
+
+enum job_state { JOB_QUEUED, JOB_RUNNING, JOB_DONE, JOB_ORPHANED };
+
+struct job {
+    struct mg_mgr *mgr;
+    unsigned long conn_id;
+    void (*work)(void *);
+    void (*done)(struct mg_connection *, void *);
+    void *arg;
+    enum job_state state;
+    struct job *prev, *next; // in-flight list
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t nonempty = PTHREAD_COND_INITIALIZER;
+static pthread_t *threads;
+static int nthreads_running, stopping;
+
+static struct job **queue; // ring buffer of queued jobs
+static size_t queue_cap, queue_head, queue_len;
+static struct job *inflight; // queued, running and undelivered jobs
+
+static struct pool_stats stats;
+
+static void inflight_unlink(struct job *j) {
+    if (j->prev) j->prev->next = j->next;
+    else inflight = j->next;
+    if (j->next) j->next->prev = j->prev;
+}
+
+static void *worker(void *unused) {
+    (void)unused;
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (queue_len == 0 && !stopping) pthread_cond_wait(&nonempty, &lock);
+        if (stopping) break;
+        struct job *j = queue[queue_head];
+        queue_head = (queue_head + 1) % queue_cap;
+        queue_len--;
+        if (j->state == JOB_QUEUED) j->state = JOB_RUNNING;
+        pthread_mutex_unlock(&lock);
+
+        j->work(j->arg);
+
+        pthread_mutex_lock(&lock);
+        stats.completed++;
+        if (j->state == JOB_ORPHANED) {
+            inflight_unlink(j);
+            pthread_mutex_unlock(&lock);
+            j->done(NULL, j->arg);
+            free(j);
+            pthread_mutex_lock(&lock);
+        } else {
+            struct job *p = j;
+            j->state = JOB_DONE;
+            mg_wakeup(j->mgr, j->conn_id, &p, sizeof(p));
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    db_close(); // workers own a connection each
+    return NULL;
+}
+
+int pool_init(int nthreads, int queue_depth) {
+    if (nthreads <= 0 || queue_depth <= 0 || threads) return -1;
+    threads = calloc((size_t)nthreads, sizeof(*threads));
+    queue = calloc((size_t)queue_depth, sizeof(*queue));
+    if (!threads || !queue) goto fail;
+    queue_cap = (size_t)queue_depth;
+    stopping = 0;
+    for (int i = 0; i < nthreads; ++i) {
+        if (pthread_create(&threads[i], NULL, worker, NULL) != 0) goto fail;
+        nthreads_running++;
+    }
+    stats.threads = (size_t)nthreads;
+    stats.queue_depth = queue_cap;
+    return 0;
+fail:
+    pool_shutdown();
+    return -1;
+}
+
+void pool_shutdown(void) {
+    pthread_mutex_lock(&lock);
+    stopping = 1;
+    pthread_cond_broadcast(&nonempty);
+    pthread_mutex_unlock(&lock);
+    for (int i = 0; i < nthreads_running; ++i) pthread_join(threads[i], NULL);
+    // Whatever is left never reaches its connection.
+    while (inflight) {
+        struct job *j = inflight;
+        inflight_unlink(j);
+        j->done(NULL, j->arg);
+        free(j);
+    }
+    free(threads);
+    free(queue);
+    threads = NULL;
+    queue = NULL;
+    nthreads_running = 0;
+    queue_cap = queue_head = queue_len = 0;
+    stats = (struct pool_stats){0};
+}
+
+bool pool_active(void) {
+    return nthreads_running > 0;
+}
+
+int pool_submit(struct mg_connection *c, void (*work)(void *),
+                void (*done)(struct mg_connection *, void *), void *arg) {
+    struct job *j;
+    int rc = -1;
+    if (!pool_active() || (j = calloc(1, sizeof(*j))) == NULL) return -1;
+    j->mgr = c->mgr;
+    j->conn_id = c->id;
+    j->work = work;
+    j->done = done;
+    j->arg = arg;
+
+    pthread_mutex_lock(&lock);
+    if (queue_len < queue_cap && !stopping) {
+        queue[(queue_head + queue_len) % queue_cap] = j;
+        queue_len++;
+        j->next = inflight;
+        if (inflight) inflight->prev = j;
+        inflight = j;
+        stats.submitted++;
+        pthread_cond_signal(&nonempty);
+        rc = 0;
+    } else {
+        stats.rejected++;
+    }
+    pthread_mutex_unlock(&lock);
+    if (rc != 0) free(j);
+    return rc;
+}
+
+void pool_wakeup(struct mg_connection *c, struct mg_str *data) {
+    struct job *j, *p;
+    if (data->len != sizeof(j)) return;
+    memcpy(&j, data->buf, sizeof(j));
+    // Only trust pointers that are still in flight for this connection.
+    pthread_mutex_lock(&lock);
+    for (p = inflight; p && p != j; p = p->next) continue;
+    if (p && p->conn_id == c->id && p->state == JOB_DONE) inflight_unlink(p);
+    else p = NULL;
+    pthread_mutex_unlock(&lock);
+    if (p) {
+        p->done(c, p->arg);
+        free(p);
+    }
+}
+
+void pool_cancel(struct mg_connection *c) {
+    struct job *j, *next, *gone = NULL;
+    pthread_mutex_lock(&lock);
+    for (j = inflight; j; j = next) {
+        next = j->next;
+        if (j->mgr != c->mgr || j->conn_id != c->id) continue;
+        if (j->state == JOB_DONE) {
+            // Its wakeup will find no connection; release it here.
+            inflight_unlink(j);
+            j->next = gone;
+            gone = j;
+        } else {
+            j->state = JOB_ORPHANED;
+        }
+        stats.orphaned++;
+    }
+    pthread_mutex_unlock(&lock);
+    for (j = gone; j; j = next) {
+        next = j->next;
+        j->done(NULL, j->arg);
+        free(j);
+    }
+}
+
+void pool_get_stats(struct pool_stats *out) {
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    out->queued = queue_len;
+    pthread_mutex_unlock(&lock);
+}
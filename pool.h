@@ -0,0 +1,35 @@
+#ifndef POOL_H
+#define POOL_H
+#include "mongoose.h"
+
+// Fixed-size worker pool for blocking work. A job's work function runs on
+// a worker thread; its done function then runs on the event loop that owns
+// the submitting connection, delivered through mg_wakeup/MG_EV_WAKEUP.
+// Every mg_mgr that submits jobs must have called mg_wakeup_init.
+
+struct pool_stats {
+    unsigned long submitted, completed, rejected, orphaned;
+    size_t queued, threads, queue_depth;
+};
+
+// Starts nthreads workers with room for queue_depth waiting jobs.
+// Returns 0 on success, -1 on error.
+int pool_init(int nthreads, int queue_depth);
+// Waits for running jobs, discards queued ones and joins the workers.
+void pool_shutdown(void);
+// Returns true if workers are running.
+bool pool_active(void);
+
+// Queues work(arg) for c. On completion done(c, arg) runs on c's event
+// loop; if c closed in the meantime, done(NULL, arg) runs instead so arg
+// can be released. Returns 0 if queued, -1 if the queue is full or the
+// pool is not running, in which case nothing is called.
+int pool_submit(struct mg_connection *c, void (*work)(void *),
+                void (*done)(struct mg_connection *, void *), void *arg);
+
+// Event handler hooks: pass MG_EV_WAKEUP data and MG_EV_CLOSE through.
+void pool_wakeup(struct mg_connection *c, struct mg_str *data);
+void pool_cancel(struct mg_connection *c);
+
+void pool_get_stats(struct pool_stats *out);
+#endif // POOL_H
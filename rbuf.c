@@ -0,0 +1,30 @@
+#include "rbuf.h"
+#include <stdlib.h>
+
+struct rbuf *rbuf_wrap(char *data, size_t len) {
+    struct rbuf *b = malloc(sizeof(*b));
+    if (!b) return NULL;
+    b->refs = 1;
+    b->len = len;
+    b->data = data;
+    b->gzip = NULL;
+    b->adler = 0;
+    return b;
+}
+
+struct rbuf *rbuf_ref(struct rbuf *b) {
+    __atomic_fetch_add(&b->refs, 1, __ATOMIC_RELAXED);
+    return b;
+}
+
+void rbuf_unref(struct rbuf *b) {
+    if (b && __atomic_sub_fetch(&b->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        rbuf_unref(b->gzip);
+        free(b->data);
+        free(b);
+    }
+}
+
+size_t rbuf_size(const struct rbuf *b) {
+    return b->len + (b->gzip ? b->gzip->len : 0);
+}
@@ -0,0 +1,23 @@
+#ifndef RBUF_H
+#define RBUF_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Immutable, reference-counted response body shared between the caches and
+// the event loops sending it. The last rbuf_unref frees it.
+struct rbuf {
+    int refs;          // updated atomically
+    size_t len;        // excluding the terminating NUL
+    char *data;        // malloc'd and NUL-terminated
+    struct rbuf *gzip; // data as a gzip member, or NULL; set before sharing
+    uint32_t adler;    // Adler-32 of data, once gzip is set
+};
+
+// Wraps a malloc'd, NUL-terminated string, taking ownership of it. Returns
+// a buffer holding one reference, or NULL (leaving data to the caller).
+struct rbuf *rbuf_wrap(char *data, size_t len);
+struct rbuf *rbuf_ref(struct rbuf *b);
+void rbuf_unref(struct rbuf *b);
+// Bytes held by b, its gzip copy included, as the caches account for them.
+size_t rbuf_size(const struct rbuf *b);
+#endif // RBUF_H
@@ -0,0 +1,207 @@
+#include "reference.h"
+#include "books.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+struct parser {
+    const char *s, *p, *end;
+    char *err;
+    size_t errlen;
+};
+
+static bool is_alpha(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+}
+
+static bool is_digit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+static void skip_space(struct parser *ps) {
+    while (ps->p < ps->end && (*ps->p == ' ' || *ps->p == '\t')) ps->p++;
+}
+
+// True at the end of an item.
+static bool at_sep(const struct parser *ps) {
+    return ps->p == ps->end || *ps->p == ';' || *ps->p == ',';
+}
+
+static bool take(struct parser *ps, char ch) {
+    if (ps->p < ps->end && *ps->p == ch) {
+        ps->p++;
+        skip_space(ps);
+        return true;
+    }
+    return false;
+}
+
+// Consumes a hyphen or an en dash.
+static bool take_dash(struct parser *ps) {
+    if (ps->end - ps->p >= 3 && (unsigned char)ps->p[0] == 0xe2 &&
+        (unsigned char)ps->p[1] == 0x80 && (unsigned char)ps->p[2] == 0x93) {
+        ps->p += 3;
+        skip_space(ps);
+        return true;
+    }
+    return take(ps, '-');
+}
+
+// A book name starts with a letter, or with 1, 2 or 3 and then a letter.
+static bool at_book(const struct parser *ps) {
+    const char *p = ps->p;
+    if (p < ps->end && *p >= '1' && *p <= '3') {
+        p++;
+        while (p < ps->end && (*p == ' ' || *p == '.')) p++;
+    }
+    return p < ps->end && is_alpha(*p);
+}
+
+// Returns the book the name at ps->p stands for, or 0.
+static int parse_book(struct parser *ps) {
+    const char *start = ps->p, *last;
+    if (is_digit(*ps->p)) ps->p++;
+    while (ps->p < ps->end && (is_alpha(*ps->p) || *ps->p == ' ' || *ps->p == '.')) ps->p++;
+    for (last = ps->p; last > start && (last[-1] == ' ' || last[-1] == '.'); --last)
+        ;
+    int book = book_lookup(start, (size_t)(last - start));
+    if (book == 0)
+        snprintf(ps->err, ps->errlen, "unknown book \"%.*s\"", (int)(last - start), start);
+    return book;
+}
+
+static bool parse_num(struct parser *ps, int *out) {
+    long n = 0;
+    if (ps->p == ps->end || !is_digit(*ps->p)) {
+        snprintf(ps->err, ps->errlen, "expected a number at offset %d", (int)(ps->p - ps->s));
+        return false;
+    }
+    while (ps->p < ps->end && is_digit(*ps->p)) {
+        if (n <= UINT16_MAX) n = n * 10 + (*ps->p - '0');
+        ps->p++;
+    }
+    if (n < 1 || n > UINT16_MAX) {
+        snprintf(ps->err, ps->errlen, "numbers must be in 1..%d", UINT16_MAX);
+        return false;
+    }
+    *out = (int)n;
+    skip_space(ps);
+    return true;
+}
+
+// Obadiah, Philemon, 2 John, 3 John and Jude have a single chapter, so
+// their references cite verses alone.
+static bool one_chapter(int book) {
+    return book == 31 || book == 57 || book == 63 || book == 64 || book == 65;
+}
+
+// The book, chapter and whether verses were named at the end of the
+// previous item, which the next one continues.
+struct context {
+    int book, chapter;
+    bool verses;
+};
+
+// Parses one item into r.
+static bool parse_item(struct parser *ps, struct context *cx, bool after_comma,
+                       struct ref_range *r) {
+    int book = cx->book, chapter, verse = 0, n;
+
+    if (at_book(ps)) {
+        if ((book = parse_book(ps)) == 0) return false;
+        skip_space(ps);
+        after_comma = false;
+        if (at_sep(ps)) {
+            *r = (struct ref_range){book, 1, 1, book, REF_END, REF_END};
+            *cx = (struct context){book, 1, false};
+            return true;
+        }
+    } else if (book == 0) {
+        snprintf(ps->err, ps->errlen, "expected a book at offset %d", (int)(ps->p - ps->s));
+        return false;
+    }
+
+    if (!parse_num(ps, &n)) return false;
+    if (take(ps, ':')) {
+        chapter = n;
+        if (!parse_num(ps, &verse)) return false;
+    } else if (one_chapter(book)) {
+        chapter = 1, verse = n;
+    } else if (after_comma && cx->verses) {
+        chapter = cx->chapter, verse = n;
+    } else {
+        chapter = n;
+    }
+    *r = (struct ref_range){book, chapter, verse ? verse : 1, book, chapter,
+                            verse ? verse : REF_END};
+
+    if (take_dash(ps)) {
+        if (at_book(ps)) {
+            if ((r->end_book = parse_book(ps)) == 0) return false;
+            skip_space(ps);
+            r->end_chapter = r->end_verse = REF_END;
+            verse = 0;
+            if (!at_sep(ps)) {
+                if (!parse_num(ps, &n)) return false;
+                r->end_chapter = n;
+                if (take(ps, ':')) {
+                    if (!parse_num(ps, &r->end_verse)) return false;
+                } else if (one_chapter(r->end_book)) {
+                    r->end_chapter = 1, r->end_verse = n;
+                }
+            }
+        } else {
+            if (!parse_num(ps, &n)) return false;
+            if (take(ps, ':')) {
+                r->end_chapter = n;
+                if (!parse_num(ps, &r->end_verse)) return false;
+            } else if (verse) {
+                r->end_verse = n;
+            } else {
+                r->end_chapter = n;
+            }
+        }
+    }
+
+    if (r->end_book < r->book ||
+        (r->end_book == r->book && (r->end_chapter < r->start_chapter ||
+                                    (r->end_chapter == r->start_chapter &&
+                                     r->end_verse < r->start_verse)))) {
+        snprintf(ps->err, ps->errlen, "range ends before it starts at offset %d",
+                 (int)(ps->p - ps->s));
+        return false;
+    }
+    *cx = (struct context){r->end_book, r->end_chapter, r->end_verse != REF_END};
+    return true;
+}
+
+int ref_parse(const char *s, size_t len, struct ref_range *out, int max,
+              char *err, size_t errlen) {
+    struct parser ps = {s, s, s + len, err, errlen};
+    struct context cx = {0, 0, false};
+    bool after_comma = false;
+    int n = 0;
+
+    skip_space(&ps);
+    while (ps.p < ps.end) {
+        if (n == max) {
+            snprintf(err, errlen, "more than %d references", max);
+            return -1;
+        }
+        if (!parse_item(&ps, &cx, after_comma, &out[n])) return -1;
+        n++;
+        if (ps.p == ps.end) break;
+        if (*ps.p != ';' && *ps.p != ',') {
+            snprintf(err, errlen, "unexpected '%c' at offset %d", *ps.p, (int)(ps.p - s));
+            return -1;
+        }
+        after_comma = *ps.p == ',';
+        ps.p++;
+        skip_space(&ps);
+    }
+    if (n == 0) {
+        snprintf(err, errlen, "no reference given");
+        return -1;
+    }
+    return n;
+}
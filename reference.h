@@ -0,0 +1,26 @@
+#ifndef REFERENCE_H
+#define REFERENCE_H
+#include <limits.h>
+#include <stddef.h>
+
+// Parser for references as people write them: "John 3:16-18; Ps 23",
+// "Gen 1:1-2:3, 5", "Mal 4 - Matt 2". Items are separated by semicolons
+// or commas. An item without a book continues the book of the one before
+// it. After a comma, a bare number is a verse of the previous chapter
+// when that item named verses, as in "John 3:16, 18"; otherwise it is a
+// chapter. A lone number after a book of one chapter is a verse ("Jude 3").
+
+// End of a chapter or book, for ranges that run through one.
+#define REF_END INT_MAX
+
+// The verses from (book, start_chapter, start_verse) through (end_book,
+// end_chapter, end_verse), inclusive, in the terms get_passage takes.
+struct ref_range {
+    int book, start_chapter, start_verse, end_book, end_chapter, end_verse;
+};
+
+// Parses s[0, len) into at most max ranges. Returns how many, or -1 and a
+// one-line reason in err.
+int ref_parse(const char *s, size_t len, struct ref_range *out, int max,
+              char *err, size_t errlen);
+#endif // REFERENCE_H
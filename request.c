@@ -0,0 +1,128 @@
+#include "request.h"
+
+// Parses a JSON integer literal. Fractions, exponents and values outside
+// int range are rejected.
+static bool parse_int(struct mg_str v, int *out) {
+    size_t i = 0;
+    long long n = 0;
+    bool neg = false;
+    if (i < v.len && v.buf[i] == '-') neg = true, i++;
+    if (i == v.len) return false;
+    for (; i < v.len; ++i) {
+        if (v.buf[i] < '0' || v.buf[i] > '9') return false;
+        n = n * 10 + (v.buf[i] - '0');
+        if (n > (long long)INT_MAX + 1) return false;
+    }
+    if (neg) n = -n;
+    if (n < INT_MIN || n > INT_MAX) return false;
+    *out = (int)n;
+    return true;
+}
+
+// Unescapes the JSON string literal v into a buffer of max + 1 bytes.
+// Returns its length, or -1 if v is not a string or does not fit.
+static int parse_str(struct mg_str v, char *out, int max) {
+    if (v.len < 2 || v.buf[0] != '"') return -1;
+    if (!mg_json_unescape(mg_str_n(v.buf + 1, v.len - 2), out, (size_t)max + 1))
+        return -1;
+    return (int)strlen(out);
+}
+
+// Stores val as the member named name, if a field names it. val is a JSON
+// literal when json is set and URL-encoded text otherwise.
+static int decode_field(const struct req_field *fields, size_t nfields, uint32_t *seen,
+                        struct mg_str name, struct mg_str val, bool json, void *out,
+                        char *err, size_t errlen) {
+    for (size_t i = 0; i < nfields; ++i) {
+        const struct req_field *f = &fields[i];
+        if (mg_strcmp(name, mg_str(f->name)) != 0) continue;
+        int v;
+        if (*seen & (1u << i)) {
+            mg_snprintf(err, errlen, "duplicate field \"%s\"", f->name);
+            return -1;
+        }
+        if (f->type == REQ_STR) {
+            char *dst = (char *)out + f->offset;
+            v = json ? parse_str(val, dst, f->max)
+                     : mg_url_decode(val.buf, val.len, dst, (size_t)f->max + 1, 1);
+            if (v >= 0) v = (int)strlen(dst);
+            if (v < f->min) {
+                mg_snprintf(err, errlen, "field \"%s\" must be a string of %d..%d bytes",
+                            f->name, f->min, f->max);
+                return -1;
+            }
+        } else if (f->type == REQ_BOOL) {
+            if (mg_strcmp(val, mg_str("true")) != 0 &&
+                mg_strcmp(val, mg_str("false")) != 0) {
+                mg_snprintf(err, errlen, "field \"%s\" must be true or false", f->name);
+                return -1;
+            }
+            *(bool *)((char *)out + f->offset) = val.buf[0] == 't';
+        } else if (!parse_int(val, &v) || v < f->min || v > f->max) {
+            mg_snprintf(err, errlen, "field \"%s\" must be an integer in %d..%d",
+                        f->name, f->min, f->max);
+            return -1;
+        } else {
+            *(int *)((char *)out + f->offset) = v;
+        }
+        *seen |= 1u << i;
+        break;
+    }
+    return 0;
+}
+
+static int check_missing(const struct req_field *fields, size_t nfields, uint32_t seen,
+                         char *err, size_t errlen) {
+    for (size_t i = 0; i < nfields; ++i) {
+        if (!(seen & (1u << i)) && !fields[i].optional) {
+            mg_snprintf(err, errlen, "missing field \"%s\"", fields[i].name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int req_decode(struct mg_str body, const struct req_field *fields,
+               size_t nfields, void *out, char *err, size_t errlen) {
+    uint32_t seen = 0;
+    struct mg_str key, val;
+    size_t ofs = 0;
+    int n = 0;
+
+    while (body.len > 0 && isspace((unsigned char)body.buf[0])) body.buf++, body.len--;
+    if (mg_json_get(body, "$", &n) != 0 || body.len == 0 || body.buf[0] != '{') {
+        mg_snprintf(err, errlen, "body must be a JSON object");
+        return -1;
+    }
+    body.len = (size_t)n;
+
+    while ((ofs = mg_json_next(body, ofs, &key, &val)) > 0) {
+        if (key.len < 2) continue;
+        if (decode_field(fields, nfields, &seen, mg_str_n(key.buf + 1, key.len - 2), val,
+                         true, out, err, errlen) != 0)
+            return -1;
+    }
+    return check_missing(fields, nfields, seen, err, errlen);
+}
+
+int req_decode_query(struct mg_str query, const struct req_field *fields,
+                     size_t nfields, void *out, char *err, size_t errlen) {
+    uint32_t seen = 0;
+    struct mg_str pair, name, val;
+
+    while (mg_span(query, &pair, &query, '&')) {
+        if (!mg_span(pair, &name, &val, '=')) continue;
+        if (decode_field(fields, nfields, &seen, name, val, false, out, err, errlen) != 0)
+            return -1;
+    }
+    return check_missing(fields, nfields, seen, err, errlen);
+}
+
+int req_decode_http(struct mg_http_message *hm, const struct req_field *fields,
+                    size_t nfields, void *out, char *err, size_t errlen) {
+    struct mg_str body = hm->body;
+    while (body.len > 0 && isspace((unsigned char)body.buf[0])) body.buf++, body.len--;
+    if (body.len == 0 && hm->query.len > 0)
+        return req_decode_query(hm->query, fields, nfields, out, err, errlen);
+    return req_decode(hm->body, fields, nfields, out, err, errlen);
+}
@@ -0,0 +1,41 @@
+#ifndef REQUEST_H
+#define REQUEST_H
+#include "mongoose.h"
+
+// Schema-driven decoder for the flat JSON request bodies of the kjv
+// endpoints. The body is walked once with mg_json_next and every member
+// named in the schema is stored at its offset in the target struct, as an
+// int, as a bool or as an unescaped, NUL-terminated string in a char
+// array. Unknown members are ignored. The same schemas decode query
+// strings, so a request can be a cacheable URL instead of a body.
+enum req_type { REQ_INT, REQ_BOOL, REQ_STR };
+
+struct req_field {
+    const char *name;
+    size_t offset;      // offsetof the member in the target struct
+    int min, max;       // inclusive range; for strings, of the length
+    enum req_type type;
+    bool optional;      // if missing, the member keeps its current value
+};
+
+#define REQ_FIELD(type, member, lo, hi) \
+    {#member, offsetof(type, member), lo, hi, REQ_INT, false}
+#define REQ_OPT_FIELD(type, member, lo, hi) \
+    {#member, offsetof(type, member), lo, hi, REQ_INT, true}
+#define REQ_OPT_BOOL_FIELD(type, member) \
+    {#member, offsetof(type, member), 0, 1, REQ_BOOL, true}
+// A non-empty string that fits the char array member with its NUL.
+#define REQ_STR_FIELD(type, member) \
+    {#member, offsetof(type, member), 1, (int)sizeof(((type *)0)->member) - 1, REQ_STR, false}
+
+// Decodes body into out. Returns 0 on success. On failure returns -1 and
+// writes a one-line reason, suitable for a 400 reply, to err.
+int req_decode(struct mg_str body, const struct req_field *fields,
+               size_t nfields, void *out, char *err, size_t errlen);
+// Likewise for the URL-encoded variables of a query string.
+int req_decode_query(struct mg_str query, const struct req_field *fields,
+                     size_t nfields, void *out, char *err, size_t errlen);
+// Decodes the query string of hm if it has one and no body, else the body.
+int req_decode_http(struct mg_http_message *hm, const struct req_field *fields,
+                    size_t nfields, void *out, char *err, size_t errlen);
+#endif // REQUEST_H
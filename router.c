@@ -1,24 +1,59 @@
 #include "kjv.h"
+#include "stats.h"
+#include "search.h"
 #include "router.h"
+#include "dispatch.h"
 #include <stddef.h>
 
+// Handlers of routes with "{name}" segments or wildcards also get what
+// they captured.
 struct route {
-    const char *pattern;
+    struct dispatch_route match;
     void (*handler)(struct mg_connection *, struct mg_http_message *);
+    void (*param_handler)(struct mg_connection *, struct mg_http_message *,
+                          const struct mg_str *params);
 };
 
-static struct route routes[] = {
-    {"/kjv/get_verse", get_verse},
-    {"/kjv/get_chapter", get_chapter},
-    {"/kjv/get_passage", get_passage},
+static const struct route routes[] = {
+    {{NULL, "/kjv/get_verse"}, get_verse, NULL},
+    {{NULL, "/kjv/get_chapter"}, get_chapter, NULL},
+    {{NULL, "/kjv/get_passage"}, get_passage, NULL},
+    {{NULL, "/kjv/batch"}, get_batch, NULL},
+    {{NULL, "/kjv/parse"}, parse_reference, NULL},
+    {{NULL, "/kjv/search"}, search, NULL},
+    {{NULL, "/kjv/autocomplete"}, autocomplete, NULL},
+    {{NULL, "/kjv/find"}, find, NULL},
+    {{NULL, "/kjv/concordance"}, concordance, NULL},
+    {{NULL, "/kjv/stats"}, get_stats, NULL},
+    {{"GET", "/kjv/{book}/{spec}"}, NULL, get_book_path},
+    {{"GET", "/kjv/{book}/{chapter}/{verses}"}, NULL, get_verse_path},
 };
 
+#define NROUTES (sizeof(routes) / sizeof(routes[0]))
+
+static struct dispatch *table;
+
+int router_init(void) {
+    struct dispatch_route match[NROUTES];
+    for (size_t i = 0; i < NROUTES; ++i) match[i] = routes[i].match;
+    return (table = dispatch_new(match, NROUTES)) != NULL ? 0 : -1;
+}
+
+void router_free(void) {
+    dispatch_free(table);
+    table = NULL;
+}
+
 void route_request(struct mg_connection *c, struct mg_http_message *hm) {
-    for (size_t i = 0; i < sizeof(routes)/sizeof(routes[0]); ++i) {
-        if (mg_match(hm->uri, mg_str(routes[i].pattern), NULL)) {
-            routes[i].handler(c, hm);
-            return;
-        }
+    struct mg_str params[DISPATCH_MAX_PARAMS];
+    long i = dispatch_find(table, hm->method, hm->uri, params);
+    if (i == DISPATCH_BAD_METHOD) {
+        mg_http_reply(c, 405, "", "Method not allowed\n");
+    } else if (i < 0) {
+        mg_http_reply(c, 404, "", "Not found\n");
+    } else if (routes[i].param_handler) {
+        routes[i].param_handler(c, hm, params);
+    } else {
+        routes[i].handler(c, hm);
     }
-    mg_http_reply(c, 404, "", "Not found\n");
 }
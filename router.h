@@ -1,5 +1,9 @@
 #ifndef ROUTER_H
 #define ROUTER_H
 #include "mongoose.h"
+// Builds the dispatch table for the routes. Call once before serving.
+// Returns 0 on success, -1 on error.
+int router_init(void);
+void router_free(void);
 void route_request(struct mg_connection *c, struct mg_http_message *hm);
 #endif // ROUTER_H
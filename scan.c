@@ -0,0 +1,153 @@
+#include "scan.h"
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+typedef const char *(*find_fn)(const char *text, size_t len, const char *needle, size_t n);
+
+static unsigned char fold(unsigned char ch) {
+    return ch >= 'A' && ch <= 'Z' ? ch + 32 : ch;
+}
+
+// Byte to OR into the text before comparing it to the folded byte ch:
+// 0x20 maps upper case letters onto lower case and only those.
+static char case_bit(unsigned char ch) {
+    return ch >= 'a' && ch <= 'z' ? 0x20 : 0;
+}
+
+static bool equal_folded(const char *s, const char *needle, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        if (fold((unsigned char)s[i]) != fold((unsigned char)needle[i])) return false;
+    return true;
+}
+
+static const char *find_scalar(const char *text, size_t len, const char *needle, size_t n) {
+    unsigned char first = fold((unsigned char)needle[0]), last = fold((unsigned char)needle[n - 1]);
+    for (size_t i = 0; i + n <= len; ++i) {
+        if (fold((unsigned char)text[i]) == first &&
+            fold((unsigned char)text[i + n - 1]) == last && equal_folded(text + i, needle, n))
+            return text + i;
+    }
+    return NULL;
+}
+
+#ifdef SCAN_X86
+// Both vector engines test the first and the last byte of the needle at W
+// consecutive positions per step and confirm each position that passes.
+// The tail too short for a full step goes to the scalar engine.
+__attribute__((target("sse2")))
+static const char *find_sse2(const char *text, size_t len, const char *needle, size_t n) {
+    unsigned char f = fold((unsigned char)needle[0]), l = fold((unsigned char)needle[n - 1]);
+    const __m128i first = _mm_set1_epi8((char)f), last = _mm_set1_epi8((char)l);
+    const __m128i first_case = _mm_set1_epi8(case_bit(f)), last_case = _mm_set1_epi8(case_bit(l));
+    size_t i = 0;
+
+    for (; i + n - 1 + 16 <= len; i += 16) {
+        __m128i a = _mm_or_si128(_mm_loadu_si128((const __m128i *)(text + i)), first_case);
+        __m128i b = _mm_or_si128(_mm_loadu_si128((const __m128i *)(text + i + n - 1)), last_case);
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        for (; mask; mask &= mask - 1) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (equal_folded(text + i + bit, needle, n)) return text + i + bit;
+        }
+    }
+    return find_scalar(text + i, len - i, needle, n);
+}
+
+__attribute__((target("avx2")))
+static const char *find_avx2(const char *text, size_t len, const char *needle, size_t n) {
+    unsigned char f = fold((unsigned char)needle[0]), l = fold((unsigned char)needle[n - 1]);
+    const __m256i first = _mm256_set1_epi8((char)f), last = _mm256_set1_epi8((char)l);
+    const __m256i first_case = _mm256_set1_epi8(case_bit(f)), last_case = _mm256_set1_epi8(case_bit(l));
+    size_t i = 0;
+
+    for (; i + n - 1 + 32 <= len; i += 32) {
+        __m256i a = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(text + i)), first_case);
+        __m256i b = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(text + i + n - 1)),
+                                    last_case);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        for (; mask; mask &= mask - 1) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (equal_folded(text + i + bit, needle, n)) return text + i + bit;
+        }
+    }
+    return find_sse2(text + i, len - i, needle, n);
+}
+#endif
+
+static const struct {
+    const char *name;
+    find_fn find;
+} engines[] = {
+#ifdef SCAN_X86
+    {"avx2", find_avx2},
+    {"sse2", find_sse2},
+#endif
+    {"scalar", find_scalar},
+};
+
+static const char *engine_name = "scalar";
+static find_fn engine = find_scalar;
+
+static bool supported(const char *name) {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "avx2") == 0) return __builtin_cpu_supports("avx2");
+    if (strcmp(name, "sse2") == 0) return __builtin_cpu_supports("sse2");
+#endif
+    return strcmp(name, "scalar") == 0;
+}
+
+void scan_init(void) {
+    // Engines are listed fastest first.
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); ++i)
+        if (scan_set_engine(engines[i].name) == 0) return;
+}
+
+int scan_set_engine(const char *name) {
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); ++i) {
+        if (strcmp(engines[i].name, name) == 0 && supported(name)) {
+            engine_name = engines[i].name;
+            engine = engines[i].find;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *scan_engine(void) {
+    return engine_name;
+}
+
+const char *scan_find(const char *text, size_t len, const char *needle, size_t n) {
+    return n == 0 || n > len ? NULL : engine(text, len, needle, n);
+}
+
+uint32_t scan_verses(const struct corpus *cp, uint32_t first, uint32_t end,
+                     const char *needle, size_t n, uint32_t *out) {
+    // Verses lie back to back in cp->text, separated by their NULs, so one
+    // scan covers them all and a needle without NUL never spans two.
+    const char *base = cp->text, *stop = base + cp->text_offset[end];
+    const char *p = base + cp->text_offset[first];
+    uint32_t count = 0, next = first;
+
+    while ((p = scan_find(p, (size_t)(stop - p), needle, n)) != NULL) {
+        // The hit is in the last verse starting at or before it.
+        uint32_t off = (uint32_t)(p - base), lo = next + 1, hi = end;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (cp->text_offset[mid] <= off) lo = mid + 1;
+            else hi = mid;
+        }
+        out[count++] = lo - 1;
+        next = lo;
+        p = base + cp->text_offset[next];
+    }
+    return count;
+}
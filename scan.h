@@ -0,0 +1,30 @@
+#ifndef SCAN_H
+#define SCAN_H
+#include <stddef.h>
+#include <stdint.h>
+#include "corpus.h"
+
+// Brute-force substring scan over the verse text for patterns no index
+// can serve. Candidate positions are those where the first and the last
+// byte of the needle both match, tested 32 (AVX2) or 16 (SSE2) positions
+// at a time, then confirmed byte by byte. Matching ignores ASCII case.
+// The engine is picked at startup from the features of the CPU.
+
+// Selects the fastest engine this CPU supports. Call once before any
+// scan; until then the scalar engine is used.
+void scan_init(void);
+// Forces the engine by name: "avx2", "sse2" or "scalar". Returns 0, or
+// -1 if the CPU or the build lacks it.
+int scan_set_engine(const char *name);
+const char *scan_engine(void);
+
+// Returns the first occurrence of needle, of length n >= 1, in text[0, len),
+// or NULL.
+const char *scan_find(const char *text, size_t len, const char *needle, size_t n);
+
+// Stores the ordinals of the verses [first, end) of cp containing needle,
+// in corpus order, in out, which must have room for end - first. Returns
+// how many.
+uint32_t scan_verses(const struct corpus *cp, uint32_t first, uint32_t end,
+                     const char *needle, size_t n, uint32_t *out);
+#endif // SCAN_H
@@ -0,0 +1,892 @@
+#include "search_index.h"
+#include "shard.h"
+#include "varint.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// BM25 parameters.
+#define BM25_K1 1.2
+#define BM25_B 0.75
+
+struct term {
+    uint32_t name;    // offset of the NUL-terminated term in names
+    uint32_t df;      // verses containing the term
+    uint32_t cf;      // occurrences of the term in the corpus
+    uint32_t block;   // first entry in blocks
+    uint32_t nblocks;
+    float idf;        // BM25 inverse document frequency
+    float max_score;  // highest BM25 score of the term in any verse
+};
+
+struct block {
+    uint32_t last;       // ordinal of the last verse in the block
+    uint32_t offset;     // of the block's first byte in postings
+    uint32_t pos_offset; // of the block's first byte in positions
+    float max_score;     // highest BM25 score of the term in the block
+};
+
+static struct {
+    struct term *terms;
+    uint32_t nterms, terms_cap;
+    uint32_t *slots; // open-addressed hash of term index + 1, 0 if empty
+    uint32_t nslots; // power of two
+    char *names;
+    size_t names_len, names_cap;
+    // Blocks of term t are [t.block, t.block + t.nblocks). A sentinel at
+    // blocks[nblocks] holds the ends of postings and positions, so block b
+    // always ends where block b + 1 starts.
+    struct block *blocks;
+    uint32_t nblocks;
+    // Per verse: the ordinal delta and the term's frequency in the verse.
+    uint8_t *postings;
+    size_t postings_len, npostings;
+    // Per verse, in step with postings: the term's token positions within
+    // the verse as deltas from the previous one.
+    uint8_t *positions;
+    size_t positions_len;
+    uint32_t max_tf; // highest frequency of any term in one verse
+    uint16_t *doc_len; // tokens per verse, saturating
+    double avg_len;
+    uint32_t nverses;
+    bool ready;
+} ix;
+
+static bool is_term_byte(unsigned char ch) {
+    return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') ||
+           (ch >= 'A' && ch <= 'Z') || ch >= 0x80;
+}
+
+// Copies the next term of s[*pos, len) into term, which has room for
+// SEARCH_MAX_TERM + 1 bytes, and advances *pos past it. Returns the
+// term's length, or 0 once s is exhausted.
+static size_t next_term(const char *s, size_t len, size_t *pos, char *term) {
+    size_t i = *pos, n = 0;
+    while (i < len && !is_term_byte((unsigned char)s[i])) i++;
+    for (; i < len && is_term_byte((unsigned char)s[i]); ++i) {
+        unsigned char ch = (unsigned char)s[i];
+        if (n < SEARCH_MAX_TERM) term[n++] = (char)(ch >= 'A' && ch <= 'Z' ? ch + 32 : ch);
+    }
+    term[n] = '\0';
+    *pos = i;
+    return n;
+}
+
+static uint32_t term_hash(const char *s, size_t n) {
+    uint32_t h = 0x811c9dc5u;
+    for (size_t i = 0; i < n; ++i) h = (h ^ (unsigned char)s[i]) * 0x01000193u;
+    return h;
+}
+
+// Returns the slot holding term s, or the empty slot where it belongs.
+static uint32_t *term_slot(const char *s, size_t n) {
+    uint32_t i = term_hash(s, n) & (ix.nslots - 1);
+    for (;; i = (i + 1) & (ix.nslots - 1)) {
+        uint32_t t = ix.slots[i];
+        if (t == 0) return &ix.slots[i];
+        const char *name = ix.names + ix.terms[t - 1].name;
+        if (strncmp(name, s, n) == 0 && name[n] == '\0') return &ix.slots[i];
+    }
+}
+
+static long term_find(const char *s, size_t n) {
+    if (!ix.ready) return -1;
+    uint32_t t = *term_slot(s, n);
+    return t ? (long)t - 1 : -1;
+}
+
+static int grow_slots(void) {
+    uint32_t n = ix.nslots ? ix.nslots * 2 : 4096;
+    uint32_t *old = ix.slots, nold = ix.nslots;
+    if ((ix.slots = calloc(n, sizeof(*ix.slots))) == NULL) {
+        ix.slots = old;
+        return -1;
+    }
+    ix.nslots = n;
+    for (uint32_t i = 0; i < nold; ++i) {
+        if (old[i] == 0) continue;
+        const char *name = ix.names + ix.terms[old[i] - 1].name;
+        *term_slot(name, strlen(name)) = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+// Returns the index of term s, adding it if it is new, or -1 on
+// allocation failure.
+static long term_add(const char *s, size_t n) {
+    uint32_t *slot;
+    if ((ix.nterms + 1) * 2 > ix.nslots && grow_slots()) return -1;
+    if (*(slot = term_slot(s, n)) != 0) return (long)*slot - 1;
+    if (ix.nterms == ix.terms_cap) {
+        uint32_t cap = ix.terms_cap ? ix.terms_cap * 2 : 4096;
+        struct term *p = realloc(ix.terms, cap * sizeof(*p));
+        if (!p) return -1;
+        ix.terms = p;
+        ix.terms_cap = cap;
+    }
+    if (ix.names_len + n + 1 > ix.names_cap) {
+        size_t cap = ix.names_cap ? ix.names_cap * 2 : 65536;
+        char *p = realloc(ix.names, cap);
+        if (!p) return -1;
+        ix.names = p;
+        ix.names_cap = cap;
+    }
+    memcpy(ix.names + ix.names_len, s, n + 1);
+    ix.terms[ix.nterms] = (struct term){.name = (uint32_t)ix.names_len};
+    ix.names_len += n + 1;
+    *slot = ++ix.nterms;
+    return (long)ix.nterms - 1;
+}
+
+// Returns the BM25 score of a term with the given idf that occurs tf times
+// in verse v.
+static double bm25(double idf, uint32_t tf, uint32_t v) {
+    double norm = BM25_K1 * (1 - BM25_B + BM25_B * ix.doc_len[v] / ix.avg_len);
+    return idf * tf * (BM25_K1 + 1) / (tf + norm);
+}
+
+// Rounds a score up to a float that is never below it, for upper bounds.
+static float bm25_bound(double score) {
+    float f = (float)score;
+    return (double)f < score ? nextafterf(f, INFINITY) : f;
+}
+
+// A token of the verse being indexed.
+struct token {
+    uint32_t term, pos;
+};
+
+static int by_term_pos(const void *a, const void *b) {
+    const struct token *x = a, *y = b;
+    if (x->term != y->term) return x->term < y->term ? -1 : 1;
+    return (x->pos > y->pos) - (x->pos < y->pos);
+}
+
+// Splits text into tokens sorted by term, then position. Terms not yet in
+// the index are added if add is set. Returns the number of tokens, or -1
+// on allocation failure.
+static long tokenize_verse(const char *text, size_t len, bool add,
+                           struct token **tok, size_t *cap) {
+    char term[SEARCH_MAX_TERM + 1];
+    size_t pos = 0, n, ntok = 0;
+    while ((n = next_term(text, len, &pos, term)) > 0) {
+        long t = add ? term_add(term, n) : (long)*term_slot(term, n) - 1;
+        if (t < 0) return -1;
+        if (ntok == *cap) {
+            size_t ncap = *cap ? *cap * 2 : 256;
+            struct token *p = realloc(*tok, ncap * sizeof(*p));
+            if (!p) return -1;
+            *tok = p;
+            *cap = ncap;
+        }
+        (*tok)[ntok] = (struct token){(uint32_t)t, (uint32_t)ntok};
+        ntok++;
+    }
+    qsort(*tok, ntok, sizeof(**tok), by_term_pos);
+    return (long)ntok;
+}
+
+// Per-term state while building: the last verse seen, as ordinal + 1 so
+// that 0 means none, how many verses so far and the encoded sizes, later
+// the write positions, in postings and positions.
+struct build {
+    uint32_t last, count;
+    size_t bytes, pos_bytes;
+};
+
+void search_index_free(void) {
+    free(ix.terms);
+    free(ix.slots);
+    free(ix.names);
+    free(ix.blocks);
+    free(ix.postings);
+    free(ix.positions);
+    free(ix.doc_len);
+    memset(&ix, 0, sizeof(ix));
+}
+
+int search_index_build(const struct corpus *cp) {
+    struct build *bt = NULL;
+    struct token *tok = NULL;
+    size_t tok_cap = 0, len;
+    uint32_t bt_cap = 0;
+    long ntok;
+
+    search_index_free();
+    if ((ix.doc_len = malloc(((size_t)cp->nverses + 1) * sizeof(*ix.doc_len))) == NULL)
+        goto oom;
+
+    // First pass: collect terms, size their posting lists and measure
+    // the verses.
+    for (uint32_t v = 0; v < cp->nverses; ++v) {
+        const char *text = corpus_text(cp, v, &len);
+        if ((ntok = tokenize_verse(text, len, true, &tok, &tok_cap)) < 0) goto oom;
+        ix.doc_len[v] = (uint16_t)(ntok > UINT16_MAX ? UINT16_MAX : ntok);
+        ix.avg_len += (double)ix.doc_len[v];
+        if (ix.nterms > bt_cap) {
+            uint32_t cap = ix.terms_cap;
+            struct build *p = realloc(bt, cap * sizeof(*p));
+            if (!p) goto oom;
+            memset(p + bt_cap, 0, (cap - bt_cap) * sizeof(*p));
+            bt = p;
+            bt_cap = cap;
+        }
+        for (long i = 0, j; i < ntok; i = j) {
+            struct build *b = &bt[tok[i].term];
+            for (j = i; j < ntok && tok[j].term == tok[i].term; ++j)
+                b->pos_bytes += varint_len(tok[j].pos - (j > i ? tok[j - 1].pos : 0));
+            uint32_t tf = (uint32_t)(j - i);
+            if (tf > ix.max_tf) ix.max_tf = tf;
+            ix.terms[tok[i].term].cf += tf;
+            b->bytes += varint_len(v - (b->last ? b->last - 1 : 0)) + varint_len(tf);
+            b->count++;
+            b->last = v + 1;
+        }
+    }
+
+    ix.nverses = cp->nverses;
+    ix.avg_len = cp->nverses && ix.avg_len > 0 ? ix.avg_len / cp->nverses : 1;
+    for (uint32_t t = 0; t < ix.nterms; ++t) {
+        struct term *tm = &ix.terms[t];
+        size_t bytes = bt[t].bytes, pos_bytes = bt[t].pos_bytes;
+        tm->df = bt[t].count;
+        tm->idf = (float)log(1 + (ix.nverses - tm->df + 0.5) / (tm->df + 0.5));
+        tm->max_score = 0;
+        tm->block = ix.nblocks;
+        tm->nblocks = (tm->df + SEARCH_BLOCK - 1) / SEARCH_BLOCK;
+        ix.nblocks += tm->nblocks;
+        ix.npostings += tm->df;
+        bt[t].bytes = ix.postings_len;
+        bt[t].pos_bytes = ix.positions_len;
+        bt[t].last = bt[t].count = 0;
+        ix.postings_len += bytes;
+        ix.positions_len += pos_bytes;
+    }
+    if (ix.postings_len > UINT32_MAX || ix.positions_len > UINT32_MAX ||
+        (ix.blocks = malloc((ix.nblocks + 1) * sizeof(*ix.blocks))) == NULL ||
+        (ix.postings = malloc(ix.postings_len ? ix.postings_len : 1)) == NULL ||
+        (ix.positions = malloc(ix.positions_len ? ix.positions_len : 1)) == NULL)
+        goto oom;
+
+    // Second pass: encode. Deltas run on across blocks, the skip table
+    // tells a block's base.
+    for (uint32_t v = 0; v < cp->nverses; ++v) {
+        const char *text = corpus_text(cp, v, &len);
+        if ((ntok = tokenize_verse(text, len, false, &tok, &tok_cap)) < 0) goto oom;
+        for (long i = 0, j; i < ntok; i = j) {
+            uint32_t t = tok[i].term;
+            struct build *b = &bt[t];
+            struct block *blk = &ix.blocks[ix.terms[t].block + b->count / SEARCH_BLOCK];
+            if (b->count % SEARCH_BLOCK == 0) {
+                blk->offset = (uint32_t)b->bytes;
+                blk->pos_offset = (uint32_t)b->pos_bytes;
+                blk->max_score = 0;
+            }
+            blk->last = v;
+            uint8_t *pp = ix.positions + b->pos_bytes;
+            for (j = i; j < ntok && tok[j].term == t; ++j)
+                pp = varint_put(pp, tok[j].pos - (j > i ? tok[j - 1].pos : 0));
+            b->pos_bytes = (size_t)(pp - ix.positions);
+            float bound = bm25_bound(bm25(ix.terms[t].idf, (uint32_t)(j - i), v));
+            if (bound > blk->max_score) blk->max_score = bound;
+            if (bound > ix.terms[t].max_score) ix.terms[t].max_score = bound;
+            uint8_t *p = varint_put(ix.postings + b->bytes, v - (b->last ? b->last - 1 : 0));
+            p = varint_put(p, (uint32_t)(j - i));
+            b->bytes = (size_t)(p - ix.postings);
+            b->count++;
+            b->last = v + 1;
+        }
+    }
+    ix.blocks[ix.nblocks] = (struct block){UINT32_MAX, (uint32_t)ix.postings_len,
+                                           (uint32_t)ix.positions_len, 0};
+    ix.ready = true;
+    free(tok);
+    free(bt);
+    return 0;
+
+oom:
+    fprintf(stderr, "search: out of memory building the index\n");
+    free(tok);
+    free(bt);
+    search_index_free();
+    return -1;
+}
+
+bool search_index_ready(void) {
+    return ix.ready;
+}
+
+// Iterates the posting list of one term. Positions are only decoded for
+// the verses that need them; the varints of the verses passed over in
+// between are skipped when they do.
+struct cursor {
+    const struct term *t;
+    uint32_t b;             // current block
+    const uint8_t *p, *end; // undecoded bytes of the current block
+    const uint8_t *pp;      // undecoded positions of the current block
+    uint32_t doc;           // current ordinal
+    uint32_t tf;            // frequency of the term in doc
+    uint32_t unread;        // positions of doc not decoded yet
+    uint32_t skip;          // positions of earlier verses to skip first
+    bool done;
+};
+
+static void cursor_load(struct cursor *c, uint32_t b) {
+    c->b = b;
+    if (b == c->t->block + c->t->nblocks) {
+        c->done = true;
+        return;
+    }
+    c->p = ix.postings + ix.blocks[b].offset;
+    c->end = ix.postings + ix.blocks[b + 1].offset;
+    c->pp = ix.positions + ix.blocks[b].pos_offset;
+    c->doc = b == c->t->block ? 0 : ix.blocks[b - 1].last;
+    c->unread = c->skip = 0;
+}
+
+static bool cursor_next(struct cursor *c) {
+    if (c->done) return false;
+    if (c->p == c->end) {
+        cursor_load(c, c->b + 1);
+        if (c->done) return false;
+    }
+    c->skip += c->unread;
+    c->doc += varint_get(&c->p);
+    c->tf = c->unread = varint_get(&c->p);
+    return true;
+}
+
+static void cursor_init(struct cursor *c, const struct term *t) {
+    c->t = t;
+    c->done = false;
+    cursor_load(c, t->block);
+    cursor_next(c);
+}
+
+// Advances c to the first verse at or after target, skipping whole blocks
+// that end before it.
+static void cursor_seek(struct cursor *c, uint32_t target) {
+    if (c->done || c->doc >= target) return;
+    if (ix.blocks[c->b].last < target) {
+        uint32_t b = c->b + 1, bend = c->t->block + c->t->nblocks;
+        while (b < bend && ix.blocks[b].last < target) b++;
+        cursor_load(c, b);
+    }
+    while (cursor_next(c) && c->doc < target) {}
+}
+
+// Decodes the positions of the term in the current verse into out, which
+// has room for ix.max_tf of them. Call at most once per verse.
+static uint32_t cursor_positions(struct cursor *c, uint32_t *out) {
+    for (; c->skip > 0; c->skip--)
+        while (*c->pp++ & 0x80) {}
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < c->unread; ++i) out[i] = pos += varint_get(&c->pp);
+    c->unread = 0;
+    return c->tf;
+}
+
+// A bare word or quoted phrase: terms that must occur at consecutive
+// positions. near is the largest gap allowed to the next unit of the
+// clause, or -1 if they are independent.
+struct unit {
+    uint8_t first, n; // terms [first, first + n) of the clause
+    int near;
+};
+
+// Units that must all match; OR separates clauses.
+struct clause {
+    uint32_t term[SEARCH_MAX_TERMS]; // terms of all units, as cursor indexes
+    uint32_t uniq[SEARCH_MAX_TERMS]; // distinct term ids, one cursor each
+    struct unit unit[SEARCH_MAX_TERMS];
+    size_t nterms, nuniq, nunits;
+    bool positional; // has a phrase or a NEAR
+    bool missing;    // names a term no verse contains
+};
+
+// Scratch space for checking the positions of one candidate verse.
+struct scratch {
+    uint32_t *pos;  // SEARCH_MAX_TERMS lists of max_tf positions
+    uint32_t npos[SEARCH_MAX_TERMS];
+    uint32_t *starts[2]; // starts of two units, max_tf each
+};
+
+static bool contains(const uint32_t *a, uint32_t n, uint32_t v) {
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (a[mid] < v) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < n && a[lo] == v;
+}
+
+// Writes the positions where unit u starts in the candidate verse to out.
+static uint32_t unit_starts(const struct clause *cl, const struct unit *u,
+                            const struct scratch *s, uint32_t *out) {
+    uint32_t c0 = cl->term[u->first], n = 0;
+    for (uint32_t i = 0; i < s->npos[c0]; ++i) {
+        uint32_t p = s->pos[c0 * ix.max_tf + i], k;
+        for (k = 1; k < u->n; ++k) {
+            uint32_t ck = cl->term[u->first + k];
+            if (!contains(&s->pos[ck * ix.max_tf], s->npos[ck], p + k)) break;
+        }
+        if (k == u->n) out[n++] = p;
+    }
+    return n;
+}
+
+// Returns true if an occurrence of unit a, starting at one of sa, and one
+// of unit b, starting at one of sb, do not overlap and leave at most
+// gap - 1 positions between them. Both lists are a verse's worth at most.
+static bool near_match(const uint32_t *sa, uint32_t na, uint32_t la,
+                       const uint32_t *sb, uint32_t nb, uint32_t lb, int gap) {
+    for (uint32_t i = 0; i < na; ++i) {
+        for (uint32_t j = 0; j < nb; ++j) {
+            uint32_t a = sa[i], b = sb[j];
+            if (b >= a + la && b - (a + la - 1) <= (uint32_t)gap) return true;
+            if (a >= b + lb && a - (b + lb - 1) <= (uint32_t)gap) return true;
+        }
+    }
+    return false;
+}
+
+// Checks the phrases and NEARs of cl against the current verse of cur.
+static bool positions_match(const struct clause *cl, struct cursor *cur,
+                            struct scratch *s) {
+    uint32_t prev_n = 0;
+    for (size_t i = 0; i < cl->nuniq; ++i)
+        s->npos[i] = cursor_positions(&cur[i], &s->pos[i * ix.max_tf]);
+    for (size_t u = 0; u < cl->nunits; ++u) {
+        uint32_t *starts = s->starts[u % 2];
+        uint32_t n = unit_starts(cl, &cl->unit[u], s, starts);
+        if (n == 0) return false;
+        if (u > 0 && cl->unit[u - 1].near >= 0 &&
+            !near_match(s->starts[(u - 1) % 2], prev_n, cl->unit[u - 1].n,
+                        starts, n, cl->unit[u].n, cl->unit[u - 1].near))
+            return false;
+        prev_n = n;
+    }
+    return true;
+}
+
+// Sets the bit of every verse in [first, end) that matches cl. Shards
+// meet inside a word of hits, so bits are set atomically.
+static void match_clause(const struct clause *cl, struct scratch *s, uint64_t *hits,
+                         uint32_t first, uint32_t end) {
+    struct cursor cur[SEARCH_MAX_TERMS];
+    // Lead with the rarest term; the others only seek.
+    size_t lead = 0;
+    for (size_t i = 0; i < cl->nuniq; ++i) {
+        cursor_init(&cur[i], &ix.terms[cl->uniq[i]]);
+        if (cur[i].t->df < cur[lead].t->df) lead = i;
+    }
+    cursor_seek(&cur[lead], first);
+    while (!cur[lead].done && cur[lead].doc < end) {
+        uint32_t doc = cur[lead].doc;
+        size_t i;
+        for (i = 0; i < cl->nuniq; ++i) {
+            if (i == lead) continue;
+            cursor_seek(&cur[i], doc);
+            if (cur[i].done) return;
+            if (cur[i].doc != doc) break;
+        }
+        if (i == cl->nuniq) {
+            if (!cl->positional || positions_match(cl, cur, s))
+                __atomic_fetch_or(&hits[doc / 64], 1ull << (doc % 64), __ATOMIC_RELAXED);
+            cursor_next(&cur[lead]);
+        } else {
+            cursor_seek(&cur[lead], cur[i].doc);
+        }
+    }
+}
+
+static bool is_space(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+// Adds the terms of s[from, to) to cl as one unit. Returns the number of
+// terms, or -1 if the query has too many.
+static int add_unit(struct clause *cl, const char *s, size_t from, size_t to,
+                    size_t *nterms) {
+    char term[SEARCH_MAX_TERM + 1];
+    size_t n, first = cl->nterms;
+    while ((n = next_term(s, to, &from, term)) > 0) {
+        if (++*nterms > SEARCH_MAX_TERMS) return -1;
+        long t = term_find(term, n);
+        size_t c;
+        // A term no verse contains empties its whole clause.
+        if (t < 0) {
+            cl->missing = true;
+            t = 0;
+        }
+        for (c = 0; c < cl->nuniq && cl->uniq[c] != (uint32_t)t; ++c) {}
+        if (c == cl->nuniq) cl->uniq[cl->nuniq++] = (uint32_t)t;
+        cl->term[cl->nterms++] = (uint32_t)c;
+    }
+    if (cl->nterms == first) return 0;
+    cl->unit[cl->nunits++] = (struct unit){(uint8_t)first, (uint8_t)(cl->nterms - first), -1};
+    if (cl->nterms - first > 1) cl->positional = true;
+    return (int)(cl->nterms - first);
+}
+
+// A boolean query split into shards: every shard sets the bits of its own
+// verses in hits.
+struct bool_query {
+    // Every clause has a term, and the one being parsed needs a slot.
+    struct clause cls[SEARCH_MAX_TERMS + 1];
+    size_t ncls;
+    uint64_t *hits;
+    bool failed;
+};
+
+static void bool_shard(void *arg, uint32_t shard, uint32_t first, uint32_t end) {
+    struct bool_query *q = arg;
+    struct scratch s;
+    (void)shard;
+    s.pos = malloc(SEARCH_MAX_TERMS * ix.max_tf * sizeof(*s.pos));
+    s.starts[0] = malloc(2 * ix.max_tf * sizeof(*s.pos));
+    s.starts[1] = s.starts[0] ? s.starts[0] + ix.max_tf : NULL;
+    if (s.pos && s.starts[0]) {
+        for (size_t i = 0; i < q->ncls; ++i) match_clause(&q->cls[i], &s, q->hits, first, end);
+    } else {
+        __atomic_store_n(&q->failed, true, __ATOMIC_RELAXED);
+    }
+    free(s.pos);
+    free(s.starts[0]);
+}
+
+long search_query(const char *query, uint32_t skip, uint32_t *out, uint32_t max,
+                  bool *truncated, char *err, size_t errlen) {
+    struct bool_query *q;
+    struct clause *cl;
+    size_t len = strlen(query), pos = 0, nterms = 0, work = 0;
+    int near = -1;
+    bool any = false;
+    long total = 0;
+
+    *truncated = false;
+    if (!ix.ready) {
+        snprintf(err, errlen, "search index not loaded");
+        return -1;
+    }
+    if ((q = calloc(1, sizeof(*q))) == NULL ||
+        (q->hits = calloc((ix.nverses + 63) / 64, sizeof(*q->hits))) == NULL) {
+        snprintf(err, errlen, "out of memory");
+        goto fail;
+    }
+
+    cl = &q->cls[0];
+    for (;;) {
+        while (pos < len && is_space(query[pos])) pos++;
+        size_t wend = pos;
+        if (pos < len && query[pos] == '"') {
+            const char *e = memchr(query + pos + 1, '"', len - pos - 1);
+            if (!e) {
+                snprintf(err, errlen, "unterminated phrase");
+                goto fail;
+            }
+            wend = (size_t)(e - query) + 1;
+        } else {
+            while (wend < len && !is_space(query[wend]) && query[wend] != '"') wend++;
+        }
+        const char *w = query + pos;
+        size_t wlen = wend - pos;
+        bool is_or = wlen == 2 && memcmp(w, "OR", 2) == 0;
+
+        if (pos == len || is_or) {
+            if (near >= 0) {
+                snprintf(err, errlen, "NEAR must join two terms");
+                goto fail;
+            }
+            if (cl->nunits == 0) {
+                snprintf(err, errlen, any || is_or ? "OR must separate terms"
+                                                   : "query has no terms");
+                goto fail;
+            }
+            if (!cl->missing) {
+                for (size_t i = 0; i < cl->nuniq; ++i) work += ix.terms[cl->uniq[i]].df;
+                q->ncls++;
+            }
+            if (pos == len) break;
+            cl = &q->cls[q->ncls];
+            memset(cl, 0, sizeof(*cl));
+        } else if (wlen > 5 && memcmp(w, "NEAR/", 5) == 0) {
+            char *endp;
+            long gap = strtol(w + 5, &endp, 10);
+            if (endp != w + wlen || gap < 1 || gap > SEARCH_MAX_NEAR) {
+                snprintf(err, errlen, "NEAR distance must be 1..%d", SEARCH_MAX_NEAR);
+                goto fail;
+            }
+            if (cl->nunits == 0 || near >= 0) {
+                snprintf(err, errlen, "NEAR must join two terms");
+                goto fail;
+            }
+            near = (int)gap;
+        } else {
+            int n = w[0] == '"' ? add_unit(cl, query, pos + 1, wend - 1, &nterms)
+                                : add_unit(cl, query, pos, wend, &nterms);
+            if (n < 0) {
+                snprintf(err, errlen, "query has more than %d terms", SEARCH_MAX_TERMS);
+                goto fail;
+            }
+            if (n > 0) {
+                any = true;
+                if (near >= 0) {
+                    cl->unit[cl->nunits - 2].near = near;
+                    cl->positional = true;
+                    near = -1;
+                }
+            }
+        }
+        pos = wend;
+    }
+
+    if (q->ncls > 0) *truncated = !shard_run(bool_shard, q, work, SHARD_BUDGET_NS);
+    if (q->failed) {
+        snprintf(err, errlen, "out of memory");
+        goto fail;
+    }
+    for (uint32_t w = 0; w < (ix.nverses + 63) / 64; ++w) {
+        for (uint64_t bits = q->hits[w]; bits; bits &= bits - 1) {
+            if ((uint64_t)total >= skip && (uint64_t)total < (uint64_t)skip + max)
+                out[total - skip] = w * 64 + (uint32_t)__builtin_ctzll(bits);
+            total++;
+        }
+    }
+    goto done;
+
+fail:
+    total = -1;
+done:
+    if (q) free(q->hits);
+    free(q);
+    return total;
+}
+
+// A ranked hit. Equal scores rank the earlier verse first.
+struct hit {
+    double score;
+    uint32_t doc;
+};
+
+static bool hit_worse(const struct hit *a, const struct hit *b) {
+    return a->score < b->score || (a->score == b->score && a->doc > b->doc);
+}
+
+// Offers h to the min-heap of the k best hits so far.
+static void heap_push(struct hit *heap, uint32_t *n, uint32_t k, struct hit h) {
+    uint32_t i;
+    if (*n < k) {
+        // Sift up from the new leaf.
+        for (i = (*n)++; i > 0 && hit_worse(&h, &heap[(i - 1) / 2]); i = (i - 1) / 2)
+            heap[i] = heap[(i - 1) / 2];
+        heap[i] = h;
+        return;
+    }
+    if (!hit_worse(&heap[0], &h)) return;
+    // Replace the root and sift down.
+    for (i = 0;;) {
+        uint32_t c = 2 * i + 1;
+        if (c >= *n) break;
+        if (c + 1 < *n && hit_worse(&heap[c + 1], &heap[c])) c++;
+        if (!hit_worse(&heap[c], &h)) break;
+        heap[i] = heap[c];
+        i = c;
+    }
+    heap[i] = h;
+}
+
+static int by_rank(const void *a, const void *b) {
+    const struct hit *x = a, *y = b;
+    return hit_worse(x, y) ? 1 : hit_worse(y, x) ? -1 : 0;
+}
+
+// Returns the last block of c at or after its current one that may hold
+// target, without decoding anything.
+static uint32_t cursor_block_for(const struct cursor *c, uint32_t target) {
+    uint32_t b = c->b, bend = c->t->block + c->t->nblocks;
+    while (b + 1 < bend && ix.blocks[b].last < target) b++;
+    return b;
+}
+
+// Block-max WAND over the cursors: a verse is only scored once the global
+// bounds of the terms up to it exceed the k-th best score, and then only
+// if the maxima of the blocks holding it do too. Otherwise the cursors
+// jump past the nearest of those blocks. Cursors drop out at end.
+static uint32_t rank_terms(struct cursor *cur, size_t n, struct hit *heap, uint32_t k,
+                           uint32_t end) {
+    struct cursor *ord[SEARCH_MAX_TERMS];
+    uint32_t nheap = 0;
+    size_t live = 0;
+
+    for (size_t i = 0; i < n; ++i) ord[live++] = &cur[i];
+    for (;;) {
+        // Keep the live cursors sorted by current verse.
+        size_t m = 0;
+        for (size_t i = 0; i < live; ++i)
+            if (!ord[i]->done && ord[i]->doc < end) ord[m++] = ord[i];
+        live = m;
+        for (size_t i = 1; i < live; ++i) {
+            struct cursor *c = ord[i];
+            size_t j = i;
+            for (; j > 0 && ord[j - 1]->doc > c->doc; --j) ord[j] = ord[j - 1];
+            ord[j] = c;
+        }
+        double threshold = nheap == k ? heap[0].score : 0;
+
+        // The pivot is the first verse whose preceding bounds exceed the
+        // threshold; every cursor on that verse joins it.
+        double bound = 0;
+        size_t p;
+        for (p = 0; p < live; ++p) {
+            bound += ord[p]->t->max_score;
+            if (bound > threshold) break;
+        }
+        if (p == live) break;
+        uint32_t pivot = ord[p]->doc;
+        while (p + 1 < live && ord[p + 1]->doc == pivot) p++;
+
+        double block_bound = 0;
+        uint32_t next = p + 1 < live ? ord[p + 1]->doc : UINT32_MAX;
+        for (size_t i = 0; i <= p; ++i) {
+            uint32_t b = cursor_block_for(ord[i], pivot);
+            block_bound += ix.blocks[b].max_score;
+            if (ix.blocks[b].last < next - 1) next = ix.blocks[b].last + 1;
+        }
+        if (block_bound <= threshold) {
+            // Nothing up to the end of the nearest block can make it.
+            if (next <= pivot) next = pivot + 1;
+            for (size_t i = 0; i <= p; ++i) cursor_seek(ord[i], next);
+        } else if (ord[0]->doc == pivot) {
+            double score = 0;
+            for (size_t i = 0; i <= p; ++i) {
+                score += bm25(ord[i]->t->idf, ord[i]->tf, pivot);
+                cursor_next(ord[i]);
+            }
+            heap_push(heap, &nheap, k, (struct hit){score, pivot});
+        } else {
+            for (size_t i = 0; i < p; ++i) cursor_seek(ord[i], pivot);
+        }
+    }
+    return nheap;
+}
+
+// A ranked query split into shards: shard i keeps the k best hits of its
+// verses in heaps + i * k.
+struct rank_query {
+    uint32_t terms[SEARCH_MAX_TERMS];
+    size_t n;
+    uint32_t k;
+    struct hit *heaps;
+    uint32_t *nheap;
+};
+
+static void rank_shard(void *arg, uint32_t shard, uint32_t first, uint32_t end) {
+    struct rank_query *q = arg;
+    struct cursor cur[SEARCH_MAX_TERMS];
+    for (size_t i = 0; i < q->n; ++i) {
+        cursor_init(&cur[i], &ix.terms[q->terms[i]]);
+        cursor_seek(&cur[i], first);
+    }
+    q->nheap[shard] = rank_terms(cur, q->n, q->heaps + (size_t)shard * q->k, q->k, end);
+}
+
+long search_ranked(const char *query, uint32_t skip, uint32_t *out, uint32_t max,
+                   bool *truncated, char *err, size_t errlen) {
+    struct rank_query q = {.k = skip + max};
+    uint32_t *terms = q.terms, k = q.k, nshards = shard_count(), nheap = 0;
+    size_t len = strlen(query), pos = 0, nterms = 0, n = 0, work = 0;
+    struct hit *heap;
+
+    *truncated = false;
+    if (!ix.ready) {
+        snprintf(err, errlen, "search index not loaded");
+        return -1;
+    }
+    if (skip > SEARCH_MAX_RANKED || max > SEARCH_MAX_RANKED - skip) {
+        snprintf(err, errlen, "ranked results stop at %d", SEARCH_MAX_RANKED);
+        return -1;
+    }
+    while (pos < len) {
+        size_t wend = pos;
+        while (wend < len && !is_space(query[wend])) wend++;
+        const char *w = query + pos;
+        if (memchr(w, '"', wend - pos) || (wend - pos == 2 && memcmp(w, "OR", 2) == 0) ||
+            (wend - pos > 5 && memcmp(w, "NEAR/", 5) == 0)) {
+            snprintf(err, errlen, "ranked queries take plain words");
+            return -1;
+        }
+        char term[SEARCH_MAX_TERM + 1];
+        size_t tn;
+        while ((tn = next_term(query, wend, &pos, term)) > 0) {
+            if (++nterms > SEARCH_MAX_TERMS) {
+                snprintf(err, errlen, "query has more than %d terms", SEARCH_MAX_TERMS);
+                return -1;
+            }
+            long t = term_find(term, tn);
+            size_t i;
+            if (t < 0) continue;
+            for (i = 0; i < n && terms[i] != (uint32_t)t; ++i) {}
+            if (i == n) terms[n++] = (uint32_t)t;
+        }
+        pos = wend;
+        while (pos < len && is_space(query[pos])) pos++;
+    }
+    if (nterms == 0) {
+        snprintf(err, errlen, "query has no terms");
+        return -1;
+    }
+    if (k == 0 || n == 0) return 0;
+    q.n = n;
+    q.heaps = malloc(((size_t)nshards + 1) * k * sizeof(*q.heaps));
+    q.nheap = calloc(nshards, sizeof(*q.nheap));
+    if (!q.heaps || !q.nheap) {
+        free(q.heaps);
+        free(q.nheap);
+        snprintf(err, errlen, "out of memory");
+        return -1;
+    }
+    for (size_t i = 0; i < n; ++i) work += ix.terms[terms[i]].df;
+    *truncated = !shard_run(rank_shard, &q, work, SHARD_BUDGET_NS);
+
+    // Merge the shards' best into the last heap, which is spare.
+    heap = q.heaps + (size_t)nshards * k;
+    for (uint32_t s = 0; s < nshards; ++s) {
+        const struct hit *h = q.heaps + (size_t)s * k;
+        for (uint32_t i = 0; i < q.nheap[s]; ++i) heap_push(heap, &nheap, k, h[i]);
+    }
+    qsort(heap, nheap, sizeof(*heap), by_rank);
+    for (uint32_t i = skip; i < nheap; ++i) out[i - skip] = heap[i].doc;
+    free(q.heaps);
+    free(q.nheap);
+    return nheap > skip ? (long)(nheap - skip) : 0;
+}
+
+void search_index_each_term(void (*fn)(const char *term, uint32_t count, void *arg),
+                            void *arg) {
+    for (uint32_t t = 0; ix.ready && t < ix.nterms; ++t)
+        fn(ix.names + ix.terms[t].name, ix.terms[t].cf, arg);
+}
+
+long search_term_find(const char *word) {
+    char term[SEARCH_MAX_TERM + 1], rest[SEARCH_MAX_TERM + 1];
+    size_t len = strlen(word), pos = 0, n = next_term(word, len, &pos, term);
+    if (n == 0 || next_term(word, len, &pos, rest) > 0) return -2;
+    return term_find(term, n);
+}
+
+void search_term_postings(uint32_t t, void (*fn)(uint32_t verse, uint32_t tf, void *arg),
+                          void *arg) {
+    struct cursor c;
+    for (cursor_init(&c, &ix.terms[t]); !c.done; cursor_next(&c)) fn(c.doc, c.tf, arg);
+}
+
+void search_get_stats(struct search_stats *out) {
+    out->terms = ix.nterms;
+    out->postings = ix.npostings;
+    out->bytes = ix.postings_len + ix.positions_len +
+                 (ix.ready ? (ix.nblocks + 1) * sizeof(*ix.blocks) : 0);
+}
@@ -0,0 +1,76 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "corpus.h"
+
+// Inverted index over the verse text of the corpus, built in memory when
+// the corpus is loaded. A term is a run of ASCII letters and digits, folded
+// to lower case, or of UTF-8 bytes, kept as they are. Each term's posting
+// list holds the ordinals of the verses containing it with the term's
+// frequency there, delta- and varint-encoded in blocks of SEARCH_BLOCK
+// verses. A skip table keeps the last ordinal and the highest BM25 score of
+// every block, so intersections jump over whole blocks and ranked queries
+// over blocks that cannot reach the top k. The term's token positions
+// within each verse are kept in a parallel stream, delta- and
+// varint-encoded as well, and only decoded for phrase and NEAR checks.
+// Queries run on the shards of shard.h, which must be set up first, and
+// stop early once they use up SHARD_BUDGET_NS of CPU. The index is
+// read-only once built and safe to query from any thread.
+#define SEARCH_BLOCK 128
+#define SEARCH_MAX_TERM 32  // longer terms are truncated
+#define SEARCH_MAX_TERMS 16 // per query
+#define SEARCH_MAX_NEAR 64
+#define SEARCH_MAX_RANKED 1000 // deepest ranked result served
+
+struct search_stats {
+    size_t terms;    // distinct terms
+    size_t postings; // (term, verse) pairs
+    size_t bytes;    // encoded posting lists, positions and skip tables
+};
+
+// Builds the index over cp, replacing any previous one. Returns 0 on
+// success, -1 on allocation failure.
+int search_index_build(const struct corpus *cp);
+void search_index_free(void);
+bool search_index_ready(void);
+
+// Evaluates query, a list of words that must all occur in a verse, with OR
+// separating alternative lists: "faith hope OR charity" matches verses
+// containing both faith and hope, or charity. A quoted phrase, or a word
+// made of several terms such as "don't", must occur at consecutive
+// positions. "a NEAR/k b" requires b to start at most k positions after the
+// end of a, or a at most k after the end of b; NEAR/1 means adjacent.
+// Stores the ordinals of matches [skip, skip + max), in corpus order, in
+// out and returns the total number of matches. If the budget ran out, only
+// the shards searched count and *truncated is set. On a malformed query or
+// allocation failure returns -1 and writes a one-line reason to err.
+long search_query(const char *query, uint32_t skip, uint32_t *out, uint32_t max,
+                  bool *truncated, char *err, size_t errlen);
+
+// Ranks the verses containing any term of query, plain words only, by
+// BM25 over verse lengths and term frequencies, and stores the ordinals
+// of ranks [skip, skip + max) in out. Returns how many were stored. Each
+// shard ranks its own verses and their best are merged; if the budget ran
+// out, only the shards searched rank and *truncated is set. The ranking
+// stops at SEARCH_MAX_RANKED; on a deeper page, a malformed query or
+// allocation failure returns -1 and writes a one-line reason to err.
+long search_ranked(const char *query, uint32_t skip, uint32_t *out, uint32_t max,
+                   bool *truncated, char *err, size_t errlen);
+
+// Calls fn for every term of the index with its number of occurrences.
+void search_index_each_term(void (*fn)(const char *term, uint32_t count, void *arg),
+                            void *arg);
+
+// Returns the index of word, folded like a query term, in the order
+// search_index_each_term visits the terms. Returns -1 if no verse
+// contains it, -2 if word is not exactly one term.
+long search_term_find(const char *word);
+// Calls fn for every verse containing term t, in corpus order, with the
+// number of times the term occurs there.
+void search_term_postings(uint32_t t, void (*fn)(uint32_t verse, uint32_t tf, void *arg),
+                          void *arg);
+
+void search_get_stats(struct search_stats *out);
+#endif // SEARCH_INDEX_H
@@ -0,0 +1,235 @@
+#include "shard.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// One shard_run call, on the caller's stack until all its tasks finish.
+struct run {
+    shard_fn fn;
+    void *arg;
+    uint64_t budget_ns, used_ns; // used_ns is updated atomically
+    uint32_t remaining;          // under lock
+    bool skipped;                // under lock
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+};
+
+struct task {
+    struct run *run;
+    uint32_t shard;
+};
+
+// Tasks [head, head + len) of a ring of cap. The owner pops from the
+// tail, thieves from the head.
+struct deque {
+    pthread_mutex_t lock;
+    struct task *ring;
+    size_t cap, head, len;
+};
+
+static struct {
+    uint32_t *first; // shard i is verses [first[i], first[i + 1])
+    uint32_t nshards;
+    struct deque *deques; // one per worker
+    pthread_t *threads;
+    int nthreads, ndeques;
+    unsigned next;   // deque for the next shard_run to start dealing at
+    // Tasks queued in all deques; workers sleep while there are none.
+    size_t pending;
+    bool stopping;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle;
+} sp = {.idle_lock = PTHREAD_MUTEX_INITIALIZER, .idle = PTHREAD_COND_INITIALIZER};
+
+static struct shard_stats stats;
+
+static uint64_t cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void run_task(struct task t) {
+    struct run *r = t.run;
+    bool skip = __atomic_load_n(&r->used_ns, __ATOMIC_RELAXED) >= r->budget_ns;
+    if (!skip) {
+        uint64_t start = cpu_ns();
+        r->fn(r->arg, t.shard, sp.first[t.shard], sp.first[t.shard + 1]);
+        __atomic_fetch_add(&r->used_ns, cpu_ns() - start, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats.tasks, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&stats.skipped, 1, __ATOMIC_RELAXED);
+    }
+    // The caller may return and free r as soon as the lock is released.
+    pthread_mutex_lock(&r->lock);
+    if (skip) r->skipped = true;
+    if (--r->remaining == 0) pthread_cond_signal(&r->done);
+    pthread_mutex_unlock(&r->lock);
+}
+
+static int deque_push(struct deque *d, struct task t) {
+    if (d->len == d->cap) {
+        size_t cap = d->cap ? d->cap * 2 : 64;
+        struct task *ring = malloc(cap * sizeof(*ring));
+        if (!ring) return -1;
+        for (size_t i = 0; i < d->len; ++i) ring[i] = d->ring[(d->head + i) % d->cap];
+        free(d->ring);
+        d->ring = ring;
+        d->cap = cap;
+        d->head = 0;
+    }
+    d->ring[(d->head + d->len++) % d->cap] = t;
+    return 0;
+}
+
+// Takes the task at the tail of deque i if own, else at its head.
+static bool deque_take(int i, bool own, struct task *t) {
+    struct deque *d = &sp.deques[i];
+    bool got = false;
+    pthread_mutex_lock(&d->lock);
+    if (d->len > 0) {
+        if (own) {
+            *t = d->ring[(d->head + d->len - 1) % d->cap];
+        } else {
+            *t = d->ring[d->head];
+            d->head = (d->head + 1) % d->cap;
+        }
+        d->len--;
+        got = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return got;
+}
+
+static void *worker(void *arg) {
+    int self = (int)(intptr_t)arg;
+    struct task t;
+    for (;;) {
+        bool got = deque_take(self, true, &t);
+        // Workers are still starting while the first look for work, so
+        // steal by the count of deques, which is settled by then.
+        for (int k = 1; !got && k < sp.ndeques; ++k) {
+            if ((got = deque_take((self + k) % sp.ndeques, false, &t)))
+                __atomic_fetch_add(&stats.steals, 1, __ATOMIC_RELAXED);
+        }
+        if (got) {
+            __atomic_fetch_sub(&sp.pending, 1, __ATOMIC_RELAXED);
+            run_task(t);
+            continue;
+        }
+        pthread_mutex_lock(&sp.idle_lock);
+        while (__atomic_load_n(&sp.pending, __ATOMIC_RELAXED) == 0 && !sp.stopping)
+            pthread_cond_wait(&sp.idle, &sp.idle_lock);
+        bool stop = sp.stopping;
+        pthread_mutex_unlock(&sp.idle_lock);
+        if (stop) return NULL;
+    }
+}
+
+int shard_init(const struct corpus *cp, int nthreads) {
+    uint32_t target = cp->nverses / SHARD_MAX + 1;
+    if (nthreads < 0 || sp.first) return -1;
+    if ((sp.first = malloc((cp->nbooks + 2) * sizeof(*sp.first))) == NULL) goto fail;
+
+    // Close a shard at the first book boundary past the target size.
+    sp.first[0] = 0;
+    for (uint32_t b = 1; b <= cp->nbooks; ++b) {
+        uint32_t end = cp->chapter_verse[cp->book_chapter[b + 1]];
+        if (end - sp.first[sp.nshards] >= target || b == cp->nbooks)
+            sp.first[++sp.nshards] = end;
+    }
+    if (sp.nshards == 0) sp.first[++sp.nshards] = cp->nverses;
+
+    if (nthreads > 0) {
+        sp.deques = calloc((size_t)nthreads, sizeof(*sp.deques));
+        sp.threads = calloc((size_t)nthreads, sizeof(*sp.threads));
+        if (!sp.deques || !sp.threads) goto fail;
+        for (; sp.ndeques < nthreads; sp.ndeques++)
+            pthread_mutex_init(&sp.deques[sp.ndeques].lock, NULL);
+        sp.stopping = false;
+        for (; sp.nthreads < nthreads; sp.nthreads++) {
+            if (pthread_create(&sp.threads[sp.nthreads], NULL, worker,
+                               (void *)(intptr_t)sp.nthreads) != 0)
+                goto fail;
+        }
+    }
+    stats.threads = (size_t)sp.nthreads;
+    stats.shards = sp.nshards;
+    return 0;
+
+fail:
+    fprintf(stderr, "shard: cannot start the search pool\n");
+    shard_shutdown();
+    return -1;
+}
+
+void shard_shutdown(void) {
+    pthread_mutex_lock(&sp.idle_lock);
+    sp.stopping = true;
+    pthread_cond_broadcast(&sp.idle);
+    pthread_mutex_unlock(&sp.idle_lock);
+    for (int i = 0; i < sp.nthreads; ++i) pthread_join(sp.threads[i], NULL);
+    for (int i = 0; i < sp.ndeques; ++i) {
+        pthread_mutex_destroy(&sp.deques[i].lock);
+        free(sp.deques[i].ring);
+    }
+    free(sp.first);
+    free(sp.deques);
+    free(sp.threads);
+    sp.first = NULL;
+    sp.deques = NULL;
+    sp.threads = NULL;
+    sp.nshards = 0;
+    sp.nthreads = sp.ndeques = 0;
+    sp.pending = 0;
+    stats = (struct shard_stats){0};
+}
+
+uint32_t shard_count(void) {
+    return sp.nshards;
+}
+
+bool shard_run(shard_fn fn, void *arg, size_t work, uint64_t budget_ns) {
+    struct run r = {.fn = fn, .arg = arg, .budget_ns = budget_ns, .remaining = sp.nshards};
+    uint32_t queued = 0;
+
+    __atomic_fetch_add(&stats.queries, 1, __ATOMIC_RELAXED);
+    pthread_mutex_init(&r.lock, NULL);
+    pthread_cond_init(&r.done, NULL);
+    if (sp.nthreads > 0 && work >= SHARD_MIN_WORK) {
+        unsigned d = __atomic_fetch_add(&sp.next, 1, __ATOMIC_RELAXED);
+        // Count the tasks in before a worker can take one.
+        __atomic_fetch_add(&sp.pending, sp.nshards, __ATOMIC_RELAXED);
+        for (uint32_t i = 0; i < sp.nshards; ++i, ++d) {
+            struct deque *q = &sp.deques[d % (unsigned)sp.nthreads];
+            pthread_mutex_lock(&q->lock);
+            int rc = deque_push(q, (struct task){&r, i});
+            pthread_mutex_unlock(&q->lock);
+            if (rc != 0) break;
+            queued++;
+        }
+        __atomic_fetch_sub(&sp.pending, sp.nshards - queued, __ATOMIC_RELAXED);
+        pthread_mutex_lock(&sp.idle_lock);
+        pthread_cond_broadcast(&sp.idle);
+        pthread_mutex_unlock(&sp.idle_lock);
+    }
+    // Whatever could not be queued runs here.
+    for (uint32_t i = queued; i < sp.nshards; ++i) run_task((struct task){&r, i});
+
+    pthread_mutex_lock(&r.lock);
+    while (r.remaining > 0) pthread_cond_wait(&r.done, &r.lock);
+    pthread_mutex_unlock(&r.lock);
+    pthread_mutex_destroy(&r.lock);
+    pthread_cond_destroy(&r.done);
+    return !r.skipped;
+}
+
+void shard_get_stats(struct shard_stats *out) {
+    out->threads = stats.threads;
+    out->shards = stats.shards;
+    out->queries = __atomic_load_n(&stats.queries, __ATOMIC_RELAXED);
+    out->tasks = __atomic_load_n(&stats.tasks, __ATOMIC_RELAXED);
+    out->steals = __atomic_load_n(&stats.steals, __ATOMIC_RELAXED);
+    out->skipped = __atomic_load_n(&stats.skipped, __ATOMIC_RELAXED);
+}
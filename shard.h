@@ -0,0 +1,45 @@
+#ifndef SHARD_H
+#define SHARD_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "corpus.h"
+
+// Work-stealing pool for CPU-bound searches. The corpus is cut into
+// shards of whole books of about nverses / SHARD_MAX verses each. A query
+// becomes one task per shard, dealt round-robin onto the workers' deques;
+// a worker takes its newest task first and, once its own deque is empty,
+// steals the oldest task of another. The caller waits for all of them.
+#define SHARD_MAX 64
+// CPU time a query's tasks may use between them. Tasks that have not
+// started once it is spent are skipped.
+#define SHARD_BUDGET_NS (200u * 1000 * 1000)
+// Queries expected to touch fewer verses run their shards on the calling
+// thread, where handing them out would cost more than it saves.
+#define SHARD_MIN_WORK 4096
+
+struct shard_stats {
+    size_t threads, shards;
+    unsigned long queries;   // shard_run calls
+    unsigned long tasks;     // shards run
+    unsigned long steals;    // of those, taken from another worker
+    unsigned long skipped;   // shards dropped for the budget
+};
+
+// Cuts cp into shards and starts nthreads workers; with none, shards run
+// on the calling thread. Returns 0 on success, -1 on error.
+int shard_init(const struct corpus *cp, int nthreads);
+// Joins the workers. No shard_run may be in progress.
+void shard_shutdown(void);
+
+// Runs fn(arg, i, first, end) for every shard i and its verses
+// [first, end), concurrently if work, the verses the query expects to
+// touch, reaches SHARD_MIN_WORK, and returns once all have finished. fn
+// must only write state of its own shard. Returns false if shards were
+// skipped because the query ran out of budget.
+typedef void (*shard_fn)(void *arg, uint32_t shard, uint32_t first, uint32_t end);
+bool shard_run(shard_fn fn, void *arg, size_t work, uint64_t budget_ns);
+uint32_t shard_count(void);
+
+void shard_get_stats(struct shard_stats *out);
+#endif // SHARD_H
@@ -0,0 +1,110 @@
+// Checks autocomplete against a sort of every word or book name that
+// starts with the prefix.
+#include "check.h"
+#include "fixture.h"
+#include "autocomplete.h"
+#include "books.h"
+#include "search_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct word {
+    char *key; // lower case
+    const char *text;
+    uint32_t id, weight;
+};
+
+static struct word *words;
+static size_t nwords, cap;
+
+static void add_word(const char *term, uint32_t count, void *arg) {
+    (void)arg;
+    if (nwords == cap) {
+        cap = cap ? cap * 2 : 1024;
+        words = realloc(words, cap * sizeof(*words));
+    }
+    words[nwords++] = (struct word){strdup(term), term, 0, count};
+}
+
+// Most frequent first; equal weights in key order.
+static int by_weight(const void *a, const void *b) {
+    const struct word *x = a, *y = b;
+    if (x->weight != y->weight) return x->weight < y->weight ? 1 : -1;
+    return strcmp(x->key, y->key);
+}
+
+static bool starts_with(const char *key, const char *prefix) {
+    for (; *prefix; ++prefix, ++key) {
+        char ch = *prefix >= 'A' && *prefix <= 'Z' ? (char)(*prefix + 32) : *prefix;
+        if (*key != ch) return false;
+    }
+    return true;
+}
+
+// Checks one lookup of prefix, with room for max hits, against the
+// entries [0, n) sorted by weight.
+static void check_prefix(const char *kind, const struct word *all, size_t n,
+                         size_t (*complete)(const char *, struct autocomplete_hit *, size_t),
+                         const char *prefix, size_t max) {
+    struct autocomplete_hit hits[AUTOCOMPLETE_MAX + 1];
+    size_t want = 0, got = complete(prefix, hits, max);
+    for (size_t i = 0; i < n && want < max && want < AUTOCOMPLETE_MAX; ++i) {
+        if (!starts_with(all[i].key, prefix)) continue;
+        if (want < got) {
+            CHECK(strcmp(hits[want].text, all[i].text) == 0 && hits[want].id == all[i].id &&
+                      hits[want].weight == all[i].weight,
+                  "%s \"%s\" #%zu: %s (%u), want %s (%u)", kind, prefix, want,
+                  hits[want].text, hits[want].weight, all[i].text, all[i].weight);
+        }
+        want++;
+    }
+    CHECK(got == want, "%s \"%s\": %zu completions, want %zu", kind, prefix, got, want);
+}
+
+int main(void) {
+    struct word books[BOOK_COUNT];
+    char prefix[32];
+    const struct corpus *cp = fixture_corpus(14, 40);
+    if (!cp || search_index_build(cp) != 0 || autocomplete_build(cp) != 0) return 1;
+
+    search_index_each_term(add_word, NULL);
+    qsort(words, nwords, sizeof(*words), by_weight);
+    for (int i = 0; i < 2000; ++i) {
+        const struct word *w = &words[fixture_rand() % nwords];
+        size_t len = fixture_rand() % (strlen(w->key) + 1);
+        memcpy(prefix, w->key, len);
+        prefix[len] = '\0';
+        if (len > 0 && fixture_rand() % 4 == 0 && prefix[0] >= 'a' && prefix[0] <= 'z')
+            prefix[0] = (char)(prefix[0] - 32);
+        check_prefix("word", words, nwords, autocomplete_words, prefix,
+                     fixture_rand() % 3 ? AUTOCOMPLETE_MAX : fixture_rand() % 5);
+    }
+    check_prefix("word", words, nwords, autocomplete_words, "qqq", AUTOCOMPLETE_MAX);
+
+    // Books past the fixture's last have no verses but still complete.
+    for (int b = 1; b <= BOOK_COUNT; ++b) {
+        uint32_t verses = 0;
+        if ((uint32_t)b <= cp->nbooks)
+            verses = cp->chapter_verse[cp->book_chapter[b + 1]] -
+                     cp->chapter_verse[cp->book_chapter[b]];
+        books[b - 1] = (struct word){strdup(book_names[b]), book_names[b], (uint32_t)b, verses};
+        for (char *p = books[b - 1].key; *p; ++p)
+            if (*p >= 'A' && *p <= 'Z') *p = (char)(*p + 32);
+    }
+    qsort(books, BOOK_COUNT, sizeof(*books), by_weight);
+    static const char *const book_prefixes[] = {"", "j", "Jo", "JOHN", "1", "1 c", "2 Ki",
+                                                "song", "x", "genesis", "genesiss"};
+    for (size_t i = 0; i < sizeof(book_prefixes) / sizeof(book_prefixes[0]); ++i) {
+        check_prefix("book", books, BOOK_COUNT, autocomplete_books, book_prefixes[i],
+                     AUTOCOMPLETE_MAX);
+        check_prefix("book", books, BOOK_COUNT, autocomplete_books, book_prefixes[i], 2);
+    }
+
+    for (size_t i = 0; i < nwords; ++i) free(words[i].key);
+    for (int b = 0; b < BOOK_COUNT; ++b) free(books[b].key);
+    free(words);
+    autocomplete_free();
+    search_index_free();
+    corpus_free();
+    return check_report("autocomplete");
+}
@@ -0,0 +1,28 @@
+#ifndef CHECK_H
+#define CHECK_H
+#include <stdio.h>
+
+// Assertions for the unit tests. A failed check prints where it is and
+// why, and the test goes on; check_report then tells whether any failed.
+static int check_failures;
+
+#define CHECK(cond, ...)                                         \
+    do {                                                         \
+        if (!(cond)) {                                           \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);      \
+            fprintf(stderr, __VA_ARGS__);                        \
+            fputc('\n', stderr);                                 \
+            check_failures++;                                    \
+        }                                                        \
+    } while (0)
+
+// Prints the outcome of test name and returns its exit status.
+static inline int check_report(const char *name) {
+    if (check_failures) {
+        printf("FAIL: %s, %d checks failed\n", name, check_failures);
+        return 1;
+    }
+    printf("PASS: %s\n", name);
+    return 0;
+}
+#endif // CHECK_H
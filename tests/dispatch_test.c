@@ -0,0 +1,121 @@
+// Table tests for dispatch_find: literal and "{name}" segments, the
+// backtracking between them, globs, and 405 against 404.
+#include "check.h"
+#include "dispatch.h"
+#include <string.h>
+
+#define NF DISPATCH_NOT_FOUND
+#define BM DISPATCH_BAD_METHOD
+
+static const struct dispatch_route routes[] = {
+    {"GET", "/api/books"},                              // 0
+    {"GET", "/api/books/{book}"},                       // 1
+    {"GET", "/api/books/{book}/chapters/{chapter}"},    // 2
+    {"GET", "/api/books/john/chapters"},                // 3
+    {"POST", "/api/books/{book}"},                      // 4
+    {NULL, "/health"},                                  // 5
+    {"GET", "/api/search"},                             // 6
+    {"DELETE", "/api/search"},                          // 7
+    {"GET", "/static/#"},                               // 8
+    {"GET", "/api/books/{book}/{chapter}/{verse}"},     // 9
+    {"GET", "/api/books/john"},                         // 10
+    {"GET", "/api/search"},                             // 11, shadowed by 6
+    {"GET", "/files/*.txt"},                            // 12
+};
+
+static const struct {
+    const char *method, *path;
+    long want;
+    const char *params[4]; // captures expected, up to the first NULL
+} cases[] = {
+    {"GET", "/api/books", 0, {NULL}},
+    {"GET", "/api/books/ruth", 1, {"ruth"}},
+    {"POST", "/api/books/ruth", 4, {"ruth"}},
+    {"GET", "/api/books/john", 10, {NULL}},
+    {"GET", "/api/books/john/chapters", 3, {NULL}},
+    {"GET", "/api/books/ruth/chapters/3", 2, {"ruth", "3"}},
+    {"GET", "/api/books/ruth/1/2", 9, {"ruth", "1", "2"}},
+
+    // The literal "john" branch dead-ends, so the {book} branch is taken.
+    {"GET", "/api/books/john/chapters/3", 2, {"john", "3"}},
+    {"GET", "/api/books/john/1/2", 9, {"john", "1", "2"}},
+    {"GET", "/api/books/johnny", 1, {"johnny"}},
+
+    // A NULL method matches them all.
+    {"GET", "/health", 5, {NULL}},
+    {"PUT", "/health", 5, {NULL}},
+    {"HEAD", "/health", 5, {NULL}},
+
+    // Same pattern, told apart by method; the first listed wins.
+    {"GET", "/api/search", 6, {NULL}},
+    {"DELETE", "/api/search", 7, {NULL}},
+
+    // Globs.
+    {"GET", "/static/css/site.css", 8, {"css/site.css"}},
+    {"GET", "/static/", 8, {""}},
+    {"GET", "/files/psalms.txt", 12, {"psalms"}},
+    {"GET", "/files/a/b.txt", NF, {NULL}}, // '*' stops at '/'
+
+    // The path matches, the method does not: 405.
+    {"PUT", "/api/search", BM, {NULL}},
+    {"PUT", "/api/books", BM, {NULL}},
+    {"DELETE", "/api/books/ruth", BM, {NULL}},
+    {"POST", "/api/books/ruth/chapters/3", BM, {NULL}},
+    {"POST", "/static/app.js", BM, {NULL}},
+    {"get", "/api/books", BM, {NULL}},
+
+    // Nothing matches the path: 404, whatever the method.
+    {"GET", "/nope", NF, {NULL}},
+    {"PUT", "/nope", NF, {NULL}},
+    {"GET", "/api/books/", NF, {NULL}},
+    {"GET", "/api/books//chapters/3", NF, {NULL}},
+    {"GET", "/api/books/ruth/chapters", NF, {NULL}},
+    {"GET", "/api/books/ruth/1/2/3", NF, {NULL}},
+    {"GET", "/api", NF, {NULL}},
+    {"GET", "api/books", NF, {NULL}},
+    {"GET", "", NF, {NULL}},
+    {"GET", "/", NF, {NULL}},
+    {"GET", "/a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p/q", NF, {NULL}},
+};
+
+static void check_case(const struct dispatch *d, size_t i) {
+    struct mg_str params[DISPATCH_MAX_PARAMS];
+    long got = dispatch_find(d, mg_str(cases[i].method), mg_str(cases[i].path), params);
+
+    CHECK(got == cases[i].want, "%s %s: %ld, want %ld", cases[i].method, cases[i].path, got,
+          cases[i].want);
+    if (got != cases[i].want || got < 0) return;
+    for (int k = 0; k < 4 && cases[i].params[k]; ++k)
+        CHECK(mg_strcmp(params[k], mg_str(cases[i].params[k])) == 0,
+              "%s %s: param %d is \"%.*s\", want \"%s\"", cases[i].method, cases[i].path, k,
+              (int)params[k].len, params[k].buf ? params[k].buf : "", cases[i].params[k]);
+}
+
+int main(void) {
+    struct dispatch *d = dispatch_new(routes, sizeof(routes) / sizeof(routes[0]));
+    if (!d) return 1;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) check_case(d, i);
+    dispatch_free(d);
+
+    // Malformed patterns are refused.
+    static const char *const bad[] = {
+        "api/books",
+        "/{a}/{b}/{c}/{d}/{e}/{f}/{g}/{h}/{i}",
+        "/a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p/q",
+        "/*/*/*/*/*/*/*/*/*",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        struct dispatch_route r = {"GET", bad[i]};
+        d = dispatch_new(&r, 1);
+        CHECK(d == NULL, "\"%s\" accepted", bad[i]);
+        dispatch_free(d);
+    }
+
+    // An empty table finds nothing.
+    struct mg_str params[DISPATCH_MAX_PARAMS];
+    d = dispatch_new(NULL, 0);
+    CHECK(d && dispatch_find(d, mg_str("GET"), mg_str("/"), params) == NF,
+          "empty table found a route");
+    dispatch_free(d);
+    return check_report("dispatch");
+}
@@ -0,0 +1,106 @@
+#include "fixture.h"
+#include <sqlite3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *const syllables[] = {"ba", "ke", "lo", "mi", "nu", "ra",
+                                        "se", "ti", "vo", "zy", "ha", "do"};
+#define NSYL (sizeof(syllables) / sizeof(syllables[0]))
+
+static char words[FIXTURE_WORDS][16];
+static uint32_t state = 1;
+
+uint32_t fixture_rand(void) {
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+const char *fixture_word(uint32_t i) {
+    return words[i];
+}
+
+// Builds the vocabulary: two syllables for the first NSYL * NSYL words,
+// three after that, so no two words are spelled alike.
+static void make_words(void) {
+    for (uint32_t i = 0; i < FIXTURE_WORDS; ++i) {
+        uint32_t n = i < NSYL * NSYL ? i : i - NSYL * NSYL;
+        char *w = words[i];
+        w += sprintf(w, "%s%s", syllables[n % NSYL], syllables[n / NSYL % NSYL]);
+        if (i >= NSYL * NSYL) w += sprintf(w, "%s", syllables[n / (NSYL * NSYL)]);
+        if (i % 7 == 3) w += sprintf(w, "eth");
+        else if (i % 31 == 5) w += sprintf(w, "\xc3\xa9");
+    }
+}
+
+// Picks a word index, low ones far more often.
+static uint32_t pick(void) {
+    double u = (fixture_rand() % 1000000) / 1e6;
+    return (uint32_t)(FIXTURE_WORDS * u * u * u);
+}
+
+// Writes one verse of 3 to 30 words to buf.
+static void make_verse(char *buf) {
+    static const char *const seps[] = {" ", " ", " ", ", ", "; ", ": "};
+    int n = 3 + (int)(fixture_rand() % 28);
+    char *p = buf;
+    for (int i = 0; i < n; ++i) {
+        const char *w = fixture_word(pick());
+        if (i > 0) p += sprintf(p, "%s", seps[fixture_rand() % 6]);
+        if (fixture_rand() % 10 == 0) {
+            *p++ = (char)(w[0] - 32);
+            w++;
+        }
+        p += sprintf(p, "%s%s", w, fixture_rand() % 25 == 0 ? "'s" : "");
+    }
+    sprintf(p, ".");
+}
+
+const struct corpus *fixture_corpus(uint32_t seed, int nbooks) {
+    char path[] = "/tmp/fixtureXXXXXX", text[1024];
+    sqlite3 *db = NULL;
+    sqlite3_stmt *stmt = NULL;
+    int fd, ok = 0;
+
+    state = seed ? seed : 1;
+    make_words();
+    if ((fd = mkstemp(path)) < 0) {
+        perror("fixture: mkstemp");
+        return NULL;
+    }
+    close(fd);
+    if (sqlite3_open(path, &db) != SQLITE_OK ||
+        sqlite3_exec(db, "CREATE TABLE kjv(book int, chapter int, verse int, text text);"
+                         "BEGIN", NULL, NULL, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "INSERT INTO kjv VALUES (?, ?, ?, ?)", -1, &stmt,
+                           NULL) != SQLITE_OK)
+        goto done;
+    for (int b = 1; b <= nbooks; ++b) {
+        int nchapters = 1 + (int)(fixture_rand() % 8);
+        for (int c = 1; c <= nchapters; ++c) {
+            int nverses = 1 + (int)(fixture_rand() % 40);
+            for (int v = 1; v <= nverses; ++v) {
+                make_verse(text);
+                sqlite3_bind_int(stmt, 1, b);
+                sqlite3_bind_int(stmt, 2, c);
+                sqlite3_bind_int(stmt, 3, v);
+                sqlite3_bind_text(stmt, 4, text, -1, SQLITE_STATIC);
+                if (sqlite3_step(stmt) != SQLITE_DONE) goto done;
+                sqlite3_reset(stmt);
+            }
+        }
+    }
+    ok = sqlite3_exec(db, "COMMIT", NULL, NULL, NULL) == SQLITE_OK;
+
+done:
+    if (!ok) fprintf(stderr, "fixture: %s\n", sqlite3_errmsg(db));
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    if (ok) ok = corpus_load_sqlite(path) == 0;
+    unlink(path);
+    return ok ? corpus_get() : NULL;
+}
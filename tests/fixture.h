@@ -0,0 +1,20 @@
+#ifndef FIXTURE_H
+#define FIXTURE_H
+#include <stdint.h>
+#include "corpus.h"
+
+// A corpus of made-up verses for the unit tests, the same for the same
+// seed. Words come from a fixed vocabulary, the first ones far more often
+// than the rest, so common terms span many posting blocks and rare ones
+// few verses. Some words end in "eth" or in a non-ASCII letter, some are
+// capitalized, and some carry "'s", which the index reads as two terms.
+#define FIXTURE_WORDS 400
+
+// Loads the corpus of nbooks books through a scratch SQLite database and
+// returns it, or NULL after printing why it could not.
+const struct corpus *fixture_corpus(uint32_t seed, int nbooks);
+// Returns vocabulary word i, i < FIXTURE_WORDS, in lower case.
+const char *fixture_word(uint32_t i);
+// Returns the next number of the generator fixture_corpus seeded.
+uint32_t fixture_rand(void);
+#endif // FIXTURE_H
@@ -0,0 +1,112 @@
+// Table tests for the reference parser and the book lookup behind it.
+#include "check.h"
+#include "books.h"
+#include "reference.h"
+#include <string.h>
+
+#define E REF_END
+#define MAX_RANGES 4
+
+static const struct {
+    const char *ref;
+    int n; // ranges, or -1 for an error
+    struct ref_range want[MAX_RANGES];
+    const char *err; // part of the reason given
+} cases[] = {
+    {"John 3:16", 1, {{43, 3, 16, 43, 3, 16}}, NULL},
+    {"john 3 : 16", 1, {{43, 3, 16, 43, 3, 16}}, NULL},
+    {"John 3:16-18", 1, {{43, 3, 16, 43, 3, 18}}, NULL},
+    {"John 3:16\xe2\x80\x93" "18", 1, {{43, 3, 16, 43, 3, 18}}, NULL},
+    {"John 3:16-18; Ps 23", 2, {{43, 3, 16, 43, 3, 18}, {19, 23, 1, 19, 23, E}}, NULL},
+    {"John 3:16, 18", 2, {{43, 3, 16, 43, 3, 16}, {43, 3, 18, 43, 3, 18}}, NULL},
+    {"John 3, 5", 2, {{43, 3, 1, 43, 3, E}, {43, 5, 1, 43, 5, E}}, NULL},
+    {"John 3:16; 18", 2, {{43, 3, 16, 43, 3, 16}, {43, 18, 1, 43, 18, E}}, NULL},
+    {"Gen 1:1-2:3, 5", 2, {{1, 1, 1, 1, 2, 3}, {1, 2, 5, 1, 2, 5}}, NULL},
+    {"Gen 1-3", 1, {{1, 1, 1, 1, 3, E}}, NULL},
+    {"Gen 1:1-3", 1, {{1, 1, 1, 1, 1, 3}}, NULL},
+    {"Gen 1 - 2:3", 1, {{1, 1, 1, 1, 2, 3}}, NULL},
+    {"Genesis", 1, {{1, 1, 1, 1, E, E}}, NULL},
+    {"Mal 4 - Matt 2", 1, {{39, 4, 1, 40, 2, E}}, NULL},
+    {"Mal 4:5 - Matt 1:2", 1, {{39, 4, 5, 40, 1, 2}}, NULL},
+    {"Mal 4 - Jude 3", 1, {{39, 4, 1, 65, 1, 3}}, NULL},
+    {"Jude 3", 1, {{65, 1, 3, 65, 1, 3}}, NULL},
+    {"Jude 3-5", 1, {{65, 1, 3, 65, 1, 5}}, NULL},
+    {"1 Cor 13", 1, {{46, 13, 1, 46, 13, E}}, NULL},
+    {"1Cor. 13:4", 1, {{46, 13, 4, 46, 13, 4}}, NULL},
+    {"II Kings 2:11", 1, {{12, 2, 11, 12, 2, 11}}, NULL},
+    {"III John 2", 1, {{64, 1, 2, 64, 1, 2}}, NULL},
+    {"1 John 1:9; 2:1", 2, {{62, 1, 9, 62, 1, 9}, {62, 2, 1, 62, 2, 1}}, NULL},
+    {"  Ps 23 ; Ps 24  ", 2, {{19, 23, 1, 19, 23, E}, {19, 24, 1, 19, 24, E}}, NULL},
+    {"Song of Solomon 2:1", 1, {{22, 2, 1, 22, 2, 1}}, NULL},
+
+    // Reversed ranges.
+    {"John 3:18-16", -1, {{0}}, "range ends before it starts"},
+    {"Gen 3-1", -1, {{0}}, "range ends before it starts"},
+    {"Gen 3:5-2:1", -1, {{0}}, "range ends before it starts"},
+    {"Exod 1 - Gen 1", -1, {{0}}, "range ends before it starts"},
+    {"Matt 1:1 - Mal 4:6", -1, {{0}}, "range ends before it starts"},
+
+    // Unknown books.
+    {"Hezekiah 1:1", -1, {{0}}, "unknown book \"Hezekiah\""},
+    {"Gen 1 - Hez 2", -1, {{0}}, "unknown book \"Hez\""},
+    {"IV John 1", -1, {{0}}, "unknown book"},
+    {"4 John 1", -1, {{0}}, "expected a book"},
+    {"3:16", -1, {{0}}, "expected a book"},
+
+    // Malformed.
+    {"", -1, {{0}}, "no reference given"},
+    {"   ", -1, {{0}}, "no reference given"},
+    {"John 0:1", -1, {{0}}, "numbers must be in"},
+    {"John 99999", -1, {{0}}, "numbers must be in"},
+    {"John 3:", -1, {{0}}, "expected a number"},
+    {"John 3:16 x", -1, {{0}}, "unexpected 'x'"},
+    {"John 3:16-", -1, {{0}}, "expected a number"},
+    {"Ruth - Esther", -1, {{0}}, "expected a number"}, // a range starts at a chapter
+    {"Gen 1; Gen 2; Gen 3; Gen 4; Gen 5", -1, {{0}}, "more than 4 references"},
+};
+
+static void check_case(size_t i) {
+    struct ref_range got[MAX_RANGES];
+    char err[128] = "";
+    const char *ref = cases[i].ref;
+    int n = ref_parse(ref, strlen(ref), got, MAX_RANGES, err, sizeof(err));
+
+    CHECK(n == cases[i].n, "\"%s\": %d ranges, want %d (%s)", ref, n, cases[i].n, err);
+    if (n != cases[i].n) return;
+    if (n < 0) {
+        CHECK(strstr(err, cases[i].err) != NULL, "\"%s\": \"%s\", want \"%s\"", ref, err,
+              cases[i].err);
+        return;
+    }
+    for (int k = 0; k < n; ++k) {
+        const struct ref_range *g = &got[k], *w = &cases[i].want[k];
+        CHECK(memcmp(g, w, sizeof(*g)) == 0,
+              "\"%s\" #%d: %d %d:%d - %d %d:%d, want %d %d:%d - %d %d:%d", ref, k, g->book,
+              g->start_chapter, g->start_verse, g->end_book, g->end_chapter, g->end_verse,
+              w->book, w->start_chapter, w->start_verse, w->end_book, w->end_chapter,
+              w->end_verse);
+    }
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) check_case(i);
+
+    // Every book by its name, in any case, and with the spaces left out.
+    for (int b = 1; b <= BOOK_COUNT; ++b) {
+        char name[32], squeezed[32];
+        size_t n = 0;
+        strcpy(name, book_names[b]);
+        CHECK(book_lookup(name, strlen(name)) == b, "\"%s\" not found", name);
+        for (char *p = name; *p; ++p) {
+            if (*p >= 'a' && *p <= 'z') *p = (char)(*p - 32);
+            if (*p != ' ') squeezed[n++] = *p;
+        }
+        CHECK(book_lookup(name, strlen(name)) == b, "\"%s\" not found", name);
+        CHECK(book_lookup(squeezed, n) == b, "\"%.*s\" not found", (int)n, squeezed);
+    }
+    static const char *const unknown[] = {"", " ", "Gen1", "Genesiss", "4 John", "Johns", "."};
+    for (size_t i = 0; i < sizeof(unknown) / sizeof(unknown[0]); ++i)
+        CHECK(book_lookup(unknown[i], strlen(unknown[i])) == 0, "\"%s\" found", unknown[i]);
+
+    return check_report("reference parser");
+}
@@ -0,0 +1,118 @@
+// Checks that every scan engine the CPU supports finds what the scalar
+// engine finds.
+#include "check.h"
+#include "fixture.h"
+#include "scan.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Few distinct bytes, so needles match often. Those around the letters
+// differ from them only in the case bit: '@' and '`' from 'A' and 'a',
+// '[' and '{' from 'Z' and 'z'.
+static const char alphabet[] = "aAbBzZ@`[{ .\xc3\xa9";
+
+static const char *const engines[] = {"avx2", "sse2"};
+
+// Fills buf[0, n) from the alphabet.
+static void random_bytes(char *buf, size_t n) {
+    for (size_t i = 0; i < n; ++i) buf[i] = alphabet[fixture_rand() % (sizeof(alphabet) - 1)];
+}
+
+// Returns the offset scan_find reports with the current engine, or -1.
+static long find(const char *text, size_t len, const char *needle, size_t n) {
+    const char *p = scan_find(text, len, needle, n);
+    return p ? p - text : -1;
+}
+
+// Known answers, for the scalar engine too.
+static void check_cases(const char *engine) {
+    static const struct {
+        const char *text, *needle;
+        long at;
+    } cases[] = {
+        {"In the beginning", "the", 3},
+        {"In the beginning", "THE", 3},
+        {"In the beginning", "g", 9},
+        {"In the beginning", "beginning", 7},
+        {"In the beginning", "ning!", -1},
+        {"And God said, Let there be light: and there was light.", "LIGHT.", 48},
+        {"@[`{", "`", 2},
+        {"@[`{", "@", 0},
+        {"ab", "abc", -1},
+    };
+    scan_set_engine(engine);
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        long at = find(cases[i].text, strlen(cases[i].text), cases[i].needle,
+                       strlen(cases[i].needle));
+        CHECK(at == cases[i].at, "%s: \"%s\" in \"%s\" at %ld, want %ld", engine,
+              cases[i].needle, cases[i].text, at, cases[i].at);
+    }
+}
+
+static void check_find(const char *engine) {
+    char buf[320], needle[48];
+    for (int i = 0; i < 20000; ++i) {
+        // Offsets into buf vary the alignment of the loads.
+        size_t off = fixture_rand() % 64, len = fixture_rand() % 256, n = 1 + fixture_rand() % 40;
+        random_bytes(buf + off, len);
+        if (len >= n && fixture_rand() % 2) {
+            // A needle from the text, in another case now and then.
+            memcpy(needle, buf + off + fixture_rand() % (len - n + 1), n);
+            for (size_t k = 0; k < n; ++k)
+                if (fixture_rand() % 4 == 0) needle[k] ^= (char)0x20;
+        } else {
+            random_bytes(needle, n);
+        }
+        scan_set_engine("scalar");
+        long want = find(buf + off, len, needle, n);
+        scan_set_engine(engine);
+        long got = find(buf + off, len, needle, n);
+        CHECK(got == want, "%s: needle of %zu in %zu bytes at +%zu found at %ld, want %ld",
+              engine, n, len, off, got, want);
+    }
+}
+
+static void check_verses(const char *engine, const struct corpus *cp) {
+    uint32_t *want = malloc(cp->nverses * sizeof(*want));
+    uint32_t *got = malloc(cp->nverses * sizeof(*got));
+    char needle[16];
+    if (!want || !got) return;
+    for (int i = 0; i < 300; ++i) {
+        size_t len, n = 1 + fixture_rand() % 10;
+        const char *text = corpus_text(cp, fixture_rand() % cp->nverses, &len);
+        if (n > len) n = len;
+        memcpy(needle, text + fixture_rand() % (len - n + 1), n);
+        uint32_t first = fixture_rand() % cp->nverses;
+        uint32_t end = first + 1 + fixture_rand() % (cp->nverses - first);
+        if (i % 3 == 0) first = 0, end = cp->nverses;
+        scan_set_engine("scalar");
+        uint32_t nwant = scan_verses(cp, first, end, needle, n, want);
+        scan_set_engine(engine);
+        uint32_t ngot = scan_verses(cp, first, end, needle, n, got);
+        CHECK(ngot == nwant && memcmp(got, want, nwant * sizeof(*got)) == 0,
+              "%s: \"%.*s\" in [%u, %u): %u verses, want %u", engine, (int)n, needle, first,
+              end, ngot, nwant);
+    }
+    free(want);
+    free(got);
+}
+
+int main(void) {
+    const struct corpus *cp = fixture_corpus(16, 20);
+    if (!cp) return 1;
+
+    check_cases("scalar");
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); ++e) {
+        if (scan_set_engine(engines[e]) != 0) {
+            printf("scan: %s not supported here, skipped\n", engines[e]);
+            continue;
+        }
+        check_cases(engines[e]);
+        check_find(engines[e]);
+        check_verses(engines[e], cp);
+    }
+    CHECK(scan_set_engine("mmx") == -1, "unknown engine accepted");
+
+    corpus_free();
+    return check_report("scan engines");
+}
@@ -0,0 +1,334 @@
+// Checks search_query against a brute-force reading of the fixture
+// corpus.
+#include "check.h"
+#include "fixture.h"
+#include "search_index.h"
+#include "shard.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_TOKENS 64
+#define NQUERIES 500
+// BM25 parameters, as search_index.c uses them.
+#define BM25_K1 1.2
+#define BM25_B 0.75
+
+// The terms of one verse in order, as the index should read them.
+struct verse {
+    int n;
+    char tok[MAX_TOKENS][SEARCH_MAX_TERM + 1];
+};
+
+static const struct corpus *cp;
+static struct verse *verses;
+static uint32_t *want, *got;
+
+static void tokenize(const char *s, size_t len, struct verse *v) {
+    size_t i = 0;
+    v->n = 0;
+    while (i < len) {
+        unsigned char ch = (unsigned char)s[i];
+        bool alnum = (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') ||
+                     (ch >= 'A' && ch <= 'Z') || ch >= 0x80;
+        if (!alnum) {
+            i++;
+            continue;
+        }
+        char *t = v->tok[v->n++];
+        size_t n = 0;
+        for (; i < len; ++i) {
+            ch = (unsigned char)s[i];
+            if (!((ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') ||
+                  (ch >= 'A' && ch <= 'Z') || ch >= 0x80))
+                break;
+            if (n < SEARCH_MAX_TERM) t[n++] = (char)(ch >= 'A' && ch <= 'Z' ? ch + 32 : ch);
+        }
+        t[n] = '\0';
+    }
+}
+
+// Returns a word for a query: mostly common ones, sometimes any word, and
+// now and then one no verse contains.
+static const char *query_word(void) {
+    uint32_t r = fixture_rand() % 100;
+    if (r < 3) return "qqq";
+    return fixture_word(r < 70 ? fixture_rand() % 40 : fixture_rand() % FIXTURE_WORDS);
+}
+
+// A unit of a query: a word, or the terms of a phrase, which must occur
+// at consecutive positions. near is the NEAR distance to the next unit,
+// or -1 if there is none.
+struct unit {
+    int n, near;
+    char term[3][SEARCH_MAX_TERM + 1];
+};
+
+// A query: clauses of units that must all occur, any clause matching.
+struct query {
+    int ncls, nunits[3];
+    struct unit unit[3][3];
+};
+
+// Fills u with n consecutive terms of a random verse.
+static void verse_unit(struct unit *u, int n) {
+    const struct verse *v;
+    do v = &verses[fixture_rand() % cp->nverses];
+    while (v->n < n);
+    int from = (int)(fixture_rand() % (uint32_t)(v->n - n + 1));
+    u->n = n;
+    for (int i = 0; i < n; ++i) strcpy(u->term[i], v->tok[from + i]);
+}
+
+// Writes a random unit to u and its text to p. Phrases and NEARs are
+// taken from the verses, so they match now and then.
+static char *random_unit(struct query *q, int c, int k, bool positional, char *p) {
+    struct unit *u = &q->unit[c][k];
+    uint32_t r = positional ? fixture_rand() % 4 : 0;
+    u->near = -1;
+    if (r == 1) {
+        // A phrase.
+        verse_unit(u, 2 + (int)(fixture_rand() % 2));
+        p += sprintf(p, " \"%s", u->term[0]);
+        for (int i = 1; i < u->n; ++i) p += sprintf(p, " %s", u->term[i]);
+        return p + sprintf(p, "\"");
+    }
+    if (r == 2) {
+        // A word with "'s", two terms.
+        u->n = 2;
+        strcpy(u->term[0], query_word());
+        strcpy(u->term[1], "s");
+        return p + sprintf(p, " %s's", u->term[0]);
+    }
+    u->n = 1;
+    strcpy(u->term[0], query_word());
+    // The query folds case like the verses do.
+    if (fixture_rand() % 4 == 0) return p + sprintf(p, " %c%s", u->term[0][0] - 32, u->term[0] + 1);
+    return p + sprintf(p, " %s", u->term[0]);
+}
+
+static void random_query(struct query *q, bool positional, char *text) {
+    char *p = text;
+    q->ncls = 1 + (int)(fixture_rand() % (positional ? 2 : 3));
+    for (int c = 0; c < q->ncls; ++c) {
+        if (c > 0) p += sprintf(p, " OR ");
+        q->nunits[c] = 1 + (int)(fixture_rand() % (positional ? 2 : 3));
+        for (int k = 0; k < q->nunits[c]; ++k) {
+            if (positional && k + 1 < q->nunits[c] && fixture_rand() % 2) {
+                // Two words a few positions apart in one verse.
+                struct unit *a = &q->unit[c][k], *b = &q->unit[c][k + 1];
+                int d = 1 + (int)(fixture_rand() % 5);
+                const struct verse *v;
+                do v = &verses[fixture_rand() % cp->nverses];
+                while (v->n <= d);
+                int from = (int)(fixture_rand() % (uint32_t)(v->n - d));
+                a->n = b->n = 1;
+                a->near = 1 + (int)(fixture_rand() % 5);
+                b->near = -1;
+                strcpy(a->term[0], v->tok[from]);
+                strcpy(b->term[0], v->tok[from + d]);
+                p += sprintf(p, " %s NEAR/%d %s", a->term[0], a->near, b->term[0]);
+                k++;
+                continue;
+            }
+            p = random_unit(q, c, k, positional, p);
+        }
+    }
+}
+
+// Stores the positions where u starts in v in starts and returns how
+// many.
+static int unit_starts(const struct unit *u, const struct verse *v, int *starts) {
+    int n = 0;
+    for (int p = 0; p + u->n <= v->n; ++p) {
+        int i = 0;
+        while (i < u->n && strcmp(v->tok[p + i], u->term[i]) == 0) i++;
+        if (i == u->n) starts[n++] = p;
+    }
+    return n;
+}
+
+static bool query_matches(const struct query *q, const struct verse *v) {
+    int starts[2][MAX_TOKENS], ns[2];
+    for (int c = 0; c < q->ncls; ++c) {
+        int k;
+        for (k = 0; k < q->nunits[c]; ++k) {
+            const struct unit *u = &q->unit[c][k];
+            if ((ns[k % 2] = unit_starts(u, v, starts[k % 2])) == 0) break;
+            if (k == 0 || q->unit[c][k - 1].near < 0) continue;
+            // One occurrence of each, apart by at most near - 1 positions
+            // and not overlapping, in either order.
+            const struct unit *prev = &q->unit[c][k - 1];
+            bool near = false;
+            for (int i = 0; i < ns[(k - 1) % 2] && !near; ++i) {
+                for (int j = 0; j < ns[k % 2] && !near; ++j) {
+                    int a = starts[(k - 1) % 2][i], b = starts[k % 2][j];
+                    near = (b >= a + prev->n && b - (a + prev->n - 1) <= prev->near) ||
+                           (a >= b + u->n && a - (b + u->n - 1) <= prev->near);
+                }
+            }
+            if (!near) break;
+        }
+        if (k == q->nunits[c]) return true;
+    }
+    return false;
+}
+
+static void check_queries(bool positional) {
+    char text[512], err[128];
+    bool truncated;
+    uint32_t nonempty = 0;
+    for (int i = 0; i < NQUERIES; ++i) {
+        struct query q;
+        uint32_t n = 0;
+        random_query(&q, positional, text);
+        for (uint32_t v = 0; v < cp->nverses; ++v)
+            if (query_matches(&q, &verses[v])) want[n++] = v;
+        nonempty += n > 0;
+        long total = search_query(text, 0, got, cp->nverses, &truncated, err, sizeof(err));
+        CHECK(total == (long)n, "\"%s\": %ld matches, want %u", text, total, n);
+        CHECK(!truncated, "\"%s\": truncated", text);
+        if (total == (long)n)
+            CHECK(memcmp(got, want, n * sizeof(*got)) == 0, "\"%s\": wrong verses", text);
+
+        // A page of the same matches.
+        uint32_t skip = n ? fixture_rand() % n : 0, max = 1 + fixture_rand() % 20;
+        total = search_query(text, skip, got, max, &truncated, err, sizeof(err));
+        uint32_t stored = n - skip < max ? n - skip : max;
+        CHECK(total == (long)n, "\"%s\" page: %ld matches, want %u", text, total, n);
+        CHECK(memcmp(got, want + skip, stored * sizeof(*got)) == 0,
+              "\"%s\" page at %u: wrong verses", text, skip);
+    }
+    // Queries that never match would prove little.
+    CHECK(nonempty > NQUERIES / 4, "only %u of %d queries matched", nonempty, NQUERIES);
+}
+
+// A verse and its BM25 score for a ranked query.
+struct scored {
+    double score;
+    uint32_t v;
+};
+
+static int by_score(const void *a, const void *b) {
+    const struct scored *x = a, *y = b;
+    if (x->score != y->score) return x->score < y->score ? 1 : -1;
+    return (x->v > y->v) - (x->v < y->v);
+}
+
+// Checks that search_ranked, which skips verses by block-max WAND, returns
+// the same top k as scoring every verse. Scores summed in another order
+// may differ in the last bits, so ranks are compared by score and verses
+// tied within that only need to be ones that match.
+static void check_ranked(void) {
+    struct scored *all = malloc(cp->nverses * sizeof(*all));
+    double *score = malloc(cp->nverses * sizeof(*score)), avg = 0;
+    char text[256], err[128];
+    bool truncated;
+    if (!all || !score) return;
+    for (uint32_t v = 0; v < cp->nverses; ++v) avg += verses[v].n;
+    avg /= cp->nverses;
+
+    for (int i = 0; i < NQUERIES; ++i) {
+        const char *word[4];
+        int nwords = 1 + (int)(fixture_rand() % 4);
+        char *p = text;
+        uint32_t n = 0;
+        memset(score, 0, cp->nverses * sizeof(*score));
+        for (int w = 0; w < nwords; ++w) {
+            int dup = 0;
+            word[w] = query_word();
+            p += sprintf(p, "%s%s", w ? " " : "", word[w]);
+            // A repeated word counts once.
+            for (int o = 0; o < w; ++o) dup |= strcmp(word[o], word[w]) == 0;
+            if (dup) continue;
+            uint32_t df = 0;
+            for (uint32_t v = 0; v < cp->nverses; ++v) {
+                for (int t = 0; t < verses[v].n; ++t) {
+                    if (strcmp(verses[v].tok[t], word[w]) != 0) continue;
+                    df++;
+                    break;
+                }
+            }
+            float idf = (float)log(1 + (cp->nverses - df + 0.5) / (df + 0.5));
+            for (uint32_t v = 0; v < cp->nverses; ++v) {
+                uint32_t tf = 0;
+                for (int t = 0; t < verses[v].n; ++t) tf += strcmp(verses[v].tok[t], word[w]) == 0;
+                if (tf == 0) continue;
+                double norm = BM25_K1 * (1 - BM25_B + BM25_B * verses[v].n / avg);
+                score[v] += idf * tf * (BM25_K1 + 1) / (tf + norm);
+            }
+        }
+        for (uint32_t v = 0; v < cp->nverses; ++v)
+            if (score[v] > 0) all[n++] = (struct scored){score[v], v};
+        qsort(all, n, sizeof(*all), by_score);
+
+        uint32_t skip = fixture_rand() % 4 ? 0 : fixture_rand() % 40;
+        uint32_t max = 1 + fixture_rand() % (fixture_rand() % 4 ? 20 : SEARCH_MAX_RANKED - skip);
+        uint32_t expect = n > skip ? (n - skip < max ? n - skip : max) : 0;
+        long got_n = search_ranked(text, skip, got, max, &truncated, err, sizeof(err));
+        CHECK(got_n == (long)expect, "\"%s\" [%u, +%u): %ld ranked, want %u", text, skip, max,
+              got_n, expect);
+        for (uint32_t r = 0; got_n == (long)expect && r < expect; ++r) {
+            double w = all[skip + r].score, g = score[got[r]];
+            CHECK(fabs(g - w) <= 1e-9 * w, "\"%s\" rank %u: verse %u scores %.12f, want %.12f",
+                  text, skip + r, got[r], g, w);
+            for (uint32_t o = 0; o < r; ++o)
+                CHECK(got[o] != got[r], "\"%s\": verse %u ranked twice", text, got[r]);
+        }
+    }
+    free(all);
+    free(score);
+}
+
+static void check_errors(void) {
+    static const char *const bad[] = {
+        "", "   ", "OR", "babe OR", "OR babe", "babe OR OR keba", "!!",
+        "a b c d e f g h i j k l m n o p q", "\"babe", "babe \"keba", "NEAR/2 babe",
+        "babe NEAR/2", "babe NEAR/0 keba", "babe NEAR/65 keba", "babe NEAR/x keba",
+        "babe NEAR/2 NEAR/2 keba", "babe NEAR/2 OR keba",
+    };
+    char err[128];
+    bool truncated;
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        err[0] = '\0';
+        CHECK(search_query(bad[i], 0, got, 10, &truncated, err, sizeof(err)) == -1,
+              "\"%s\" accepted", bad[i]);
+        CHECK(err[0] != '\0', "\"%s\": no reason given", bad[i]);
+    }
+
+    // Ranked queries take plain words, and only so deep.
+    static const char *const bad_ranked[] = {"", "!!", "\"babe keba\"", "babe OR keba",
+                                            "babe NEAR/2 keba"};
+    for (size_t i = 0; i < sizeof(bad_ranked) / sizeof(bad_ranked[0]); ++i)
+        CHECK(search_ranked(bad_ranked[i], 0, got, 10, &truncated, err, sizeof(err)) == -1,
+              "ranked \"%s\" accepted", bad_ranked[i]);
+    CHECK(search_ranked("babe", SEARCH_MAX_RANKED, got, 1, &truncated, err, sizeof(err)) == -1,
+          "ranked page past %d accepted", SEARCH_MAX_RANKED);
+}
+
+int main(void) {
+    if ((cp = fixture_corpus(11, 66)) == NULL) return 1;
+    verses = malloc(cp->nverses * sizeof(*verses));
+    want = malloc(cp->nverses * sizeof(*want));
+    got = malloc(cp->nverses * sizeof(*got));
+    if (!verses || !want || !got || shard_init(cp, 4) != 0 || search_index_build(cp) != 0)
+        return 1;
+    for (uint32_t v = 0; v < cp->nverses; ++v) {
+        size_t len;
+        const char *text = corpus_text(cp, v, &len);
+        tokenize(text, len, &verses[v]);
+    }
+
+    check_queries(false);
+    check_queries(true);
+    check_ranked();
+    check_errors();
+
+    search_index_free();
+    shard_shutdown();
+    corpus_free();
+    free(verses);
+    free(want);
+    free(got);
+    return check_report("search index");
+}
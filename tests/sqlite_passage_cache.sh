@@ -0,0 +1,33 @@
+#!/bin/sh
+# Serves one passage twice from a database the corpus cannot be loaded
+# from, so every query goes to SQLite, and checks that the second request
+# is answered from the passage cache.
+set -e
+BIN=$(cd "$(dirname "$0")/.." && pwd)/server
+dir=$(mktemp -d)
+pid=
+trap '[ -n "$pid" ] && kill $pid; rm -rf "$dir"' EXIT
+
+# Genesis 1 without verse 5: not densely numbered, so the corpus refuses it.
+sqlite3 "$dir/db.db" "CREATE TABLE kjv(book int, chapter int, verse int, text text);
+WITH RECURSIVE v(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM v WHERE n < 10)
+INSERT INTO kjv SELECT 1, 1, n, 'verse ' || n FROM v WHERE n != 5;"
+
+cd "$dir"
+"$BIN" -t 2 > log 2>&1 &
+pid=$!
+for i in $(seq 50); do curl -s -o /dev/null localhost:8000/ && break; sleep 0.1; done
+grep -q "serving from SQLite" log || { echo "FAIL: corpus loaded"; exit 1; }
+
+hits() {
+    curl -s localhost:8000/kjv/stats |
+        python3 -c 'import json, sys; print(json.load(sys.stdin)["passage_cache"]["hits"])'
+}
+first=$(curl -s localhost:8000/kjv/1/1:1-3)
+before=$(hits)
+second=$(curl -s localhost:8000/kjv/1/1:1-3)
+after=$(hits)
+
+[ -n "$first" ] && [ "$first" = "$second" ] || { echo "FAIL: replies differ"; exit 1; }
+[ "$after" -eq $((before + 1)) ] || { echo "FAIL: hits $before -> $after"; exit 1; }
+echo "PASS: sqlite passage cache"
@@ -0,0 +1,146 @@
+// Checks trigram_search against matching every verse directly.
+#include "check.h"
+#include "fixture.h"
+#include "scan.h"
+#include "shard.h"
+#include "trigram.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NPATTERNS 1000
+
+static const struct corpus *cp;
+static uint32_t *want, *got;
+
+static char fold(char ch) {
+    return ch >= 'A' && ch <= 'Z' ? (char)(ch + 32) : ch;
+}
+
+static bool is_word_byte(unsigned char ch) {
+    return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') ||
+           (ch >= 'A' && ch <= 'Z') || ch >= 0x80;
+}
+
+static bool substring(const char *text, size_t len, const char *p, size_t n) {
+    for (size_t i = 0; i + n <= len; ++i) {
+        size_t j = 0;
+        while (j < n && fold(text[i + j]) == fold(p[j])) j++;
+        if (j == n) return true;
+    }
+    return false;
+}
+
+// Matches the whole of w[0, n) against p, where '*' is any run of bytes.
+static bool glob(const char *w, size_t n, const char *p) {
+    if (*p == '\0') return n == 0;
+    if (*p == '*') {
+        for (size_t k = 0; k <= n; ++k)
+            if (glob(w + k, n - k, p + 1)) return true;
+        return false;
+    }
+    return n > 0 && fold(*w) == fold(*p) && glob(w + 1, n - 1, p + 1);
+}
+
+static bool matches(const char *text, size_t len, const char *p) {
+    if (!strchr(p, '*')) return substring(text, len, p, strlen(p));
+    for (size_t i = 0; i < len;) {
+        size_t start = i;
+        while (i < len && is_word_byte((unsigned char)text[i])) i++;
+        if (i > start && glob(text + start, i - start, p)) return true;
+        if (i == start) i++;
+    }
+    return false;
+}
+
+// Writes a random pattern to p: a piece of a verse, in any case, or a
+// word with parts replaced by wildcards.
+static void random_pattern(char *p) {
+    size_t len;
+    const char *text = corpus_text(cp, fixture_rand() % cp->nverses, &len);
+    if (fixture_rand() % 2) {
+        size_t n = 1 + fixture_rand() % 12;
+        if (n > len) n = len;
+        size_t from = fixture_rand() % (len - n + 1);
+        for (size_t i = 0; i < n; ++i) {
+            char ch = text[from + i];
+            p[i] = fixture_rand() % 3 == 0 && ch >= 'a' && ch <= 'z' ? (char)(ch - 32) : ch;
+        }
+        p[n] = '\0';
+        return;
+    }
+    const char *w = fixture_word(fixture_rand() % FIXTURE_WORDS);
+    size_t n = strlen(w), a = fixture_rand() % (n + 1), b = a + fixture_rand() % (n - a + 1);
+    switch (fixture_rand() % 4) {
+    case 0: sprintf(p, "%.*s*", (int)b, w); break;              // begat*
+    case 1: sprintf(p, "*%s", w + a); break;                    // *eth
+    case 2: sprintf(p, "%.*s*%s", (int)a, w, w + b); break;     // b*t
+    default: sprintf(p, "*%.*s*", (int)(b - a), w + a); break;  // *ega*
+    }
+}
+
+static void check_pattern(const char *p) {
+    char err[128];
+    bool truncated;
+    uint32_t n = 0;
+    for (uint32_t v = 0; v < cp->nverses; ++v) {
+        size_t len;
+        const char *text = corpus_text(cp, v, &len);
+        if (matches(text, len, p)) want[n++] = v;
+    }
+    // Wildcards alone are refused, whatever the verses hold.
+    if (strspn(p, "*") == strlen(p)) {
+        CHECK(trigram_search(p, 0, got, cp->nverses, &truncated, err, sizeof(err)) == -1,
+              "\"%s\" accepted", p);
+        return;
+    }
+    long total = trigram_search(p, 0, got, cp->nverses, &truncated, err, sizeof(err));
+    CHECK(total == (long)n, "\"%s\": %ld matches, want %u", p, total, n);
+    CHECK(!truncated, "\"%s\": truncated", p);
+    if (total == (long)n)
+        CHECK(memcmp(got, want, n * sizeof(*got)) == 0, "\"%s\": wrong verses", p);
+
+    uint32_t skip = n ? fixture_rand() % n : 0, max = 1 + fixture_rand() % 20;
+    uint32_t stored = n - skip < max ? n - skip : max;
+    total = trigram_search(p, skip, got, max, &truncated, err, sizeof(err));
+    CHECK(total == (long)n, "\"%s\" page: %ld matches, want %u", p, total, n);
+    CHECK(memcmp(got, want + skip, stored * sizeof(*got)) == 0,
+          "\"%s\" page at %u: wrong verses", p, skip);
+}
+
+int main(void) {
+    static const char *const fixed[] = {
+        "a", "A", "e", "'", "'s", " ", ".", "zz", "qqq", "\xc3\xa9", "*eth", "ba*", "*BA*",
+        "\xc3\xa9*", "*\xc3\xa9", "ba*ke", "b*a*k*e", "ba ke*", "*",
+    };
+    static const char *const bad[] = {
+        "**", "a*b*c*d*e*f",
+        "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklm",
+    };
+    char p[80], err[128];
+    bool truncated;
+
+    scan_init();
+    if ((cp = fixture_corpus(15, 66)) == NULL) return 1;
+    want = malloc(cp->nverses * sizeof(*want));
+    got = malloc(cp->nverses * sizeof(*got));
+    if (!want || !got || shard_init(cp, 4) != 0 || trigram_build(cp) != 0) return 1;
+
+    for (size_t i = 0; i < sizeof(fixed) / sizeof(fixed[0]); ++i) check_pattern(fixed[i]);
+    for (int i = 0; i < NPATTERNS; ++i) {
+        random_pattern(p);
+        check_pattern(p);
+    }
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        err[0] = '\0';
+        CHECK(trigram_search(bad[i], 0, got, 10, &truncated, err, sizeof(err)) == -1 &&
+                  err[0] != '\0',
+              "\"%s\" accepted", bad[i]);
+    }
+
+    trigram_free();
+    shard_shutdown();
+    corpus_free();
+    free(want);
+    free(got);
+    return check_report("trigram index");
+}
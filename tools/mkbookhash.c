@@ -0,0 +1,178 @@
+// Generates books_hash.h, the perfect hash table that book_lookup resolves
+// book names and abbreviations through. Keys are in the form book_lookup
+// folds names to: lower case letters and digits only.
+//
+//   mkbookhash > books_hash.h
+#include "books.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BUCKETS 64
+#define SLOTS 512
+#define KEY_MAX 15
+
+// Keys of each book, full name first.
+static const char *const aliases[BOOK_COUNT + 1][8] = {
+    [1] = {"genesis", "gen", "ge", "gn"},
+    [2] = {"exodus", "exod", "exo", "ex"},
+    [3] = {"leviticus", "lev", "le", "lv"},
+    [4] = {"numbers", "num", "nu", "nm", "nb"},
+    [5] = {"deuteronomy", "deut", "de", "dt"},
+    [6] = {"joshua", "josh", "jos", "jsh"},
+    [7] = {"judges", "judg", "jdg", "jg", "jdgs"},
+    [8] = {"ruth", "rth", "ru"},
+    [9] = {"1samuel", "1sam", "1sa", "1sm", "1s"},
+    [10] = {"2samuel", "2sam", "2sa", "2sm", "2s"},
+    [11] = {"1kings", "1kgs", "1ki", "1kin", "1k"},
+    [12] = {"2kings", "2kgs", "2ki", "2kin", "2k"},
+    [13] = {"1chronicles", "1chron", "1chr", "1ch"},
+    [14] = {"2chronicles", "2chron", "2chr", "2ch"},
+    [15] = {"ezra", "ezr"},
+    [16] = {"nehemiah", "neh", "ne"},
+    [17] = {"esther", "esth", "est", "es"},
+    [18] = {"job", "jb"},
+    [19] = {"psalms", "psalm", "ps", "psa", "pss", "psm"},
+    [20] = {"proverbs", "prov", "pro", "prv", "pr"},
+    [21] = {"ecclesiastes", "eccles", "eccl", "ecc", "ec", "qoh"},
+    [22] = {"songofsolomon", "songofsongs", "song", "sos", "canticles", "cant", "ss"},
+    [23] = {"isaiah", "isa", "is"},
+    [24] = {"jeremiah", "jer", "je", "jr"},
+    [25] = {"lamentations", "lam", "la"},
+    [26] = {"ezekiel", "ezek", "eze", "ezk"},
+    [27] = {"daniel", "dan", "da", "dn"},
+    [28] = {"hosea", "hos", "ho"},
+    [29] = {"joel", "jl"},
+    [30] = {"amos", "am"},
+    [31] = {"obadiah", "obad", "ob"},
+    [32] = {"jonah", "jnh", "jon"},
+    [33] = {"micah", "mic", "mc"},
+    [34] = {"nahum", "nah", "na"},
+    [35] = {"habakkuk", "hab", "hb"},
+    [36] = {"zephaniah", "zeph", "zep", "zp"},
+    [37] = {"haggai", "hag", "hg"},
+    [38] = {"zechariah", "zech", "zec", "zc"},
+    [39] = {"malachi", "mal", "ml"},
+    [40] = {"matthew", "matt", "mat", "mt"},
+    [41] = {"mark", "mrk", "mar", "mk", "mr"},
+    [42] = {"luke", "luk", "lk"},
+    [43] = {"john", "jhn", "joh", "jn"},
+    [44] = {"acts", "act", "ac"},
+    [45] = {"romans", "rom", "ro", "rm"},
+    [46] = {"1corinthians", "1cor", "1co"},
+    [47] = {"2corinthians", "2cor", "2co"},
+    [48] = {"galatians", "gal", "ga"},
+    [49] = {"ephesians", "ephes", "eph"},
+    [50] = {"philippians", "phil", "php"},
+    [51] = {"colossians", "col"},
+    [52] = {"1thessalonians", "1thess", "1thes", "1th"},
+    [53] = {"2thessalonians", "2thess", "2thes", "2th"},
+    [54] = {"1timothy", "1tim", "1ti"},
+    [55] = {"2timothy", "2tim", "2ti"},
+    [56] = {"titus", "tit", "ti"},
+    [57] = {"philemon", "philem", "phlm", "phm", "pm"},
+    [58] = {"hebrews", "heb"},
+    [59] = {"james", "jas", "jm"},
+    [60] = {"1peter", "1pet", "1pe", "1pt", "1p"},
+    [61] = {"2peter", "2pet", "2pe", "2pt", "2p"},
+    [62] = {"1john", "1jhn", "1joh", "1jn", "1jo"},
+    [63] = {"2john", "2jhn", "2joh", "2jn", "2jo"},
+    [64] = {"3john", "3jhn", "3joh", "3jn", "3jo"},
+    [65] = {"jude", "jud", "jd"},
+    [66] = {"revelation", "revelations", "rev", "re", "rv"},
+};
+
+struct key {
+    const char *s;
+    int book;
+};
+
+static struct key keys[BOOK_COUNT * 8];
+static int nkeys;
+static uint16_t disp[BUCKETS];
+static const struct key *slots[SLOTS];
+
+static uint32_t bucket_of(const struct key *k) {
+    return book_hash(0, k->s, strlen(k->s)) & (BUCKETS - 1);
+}
+
+// Finds a displacement that sends every key of bucket b to a free slot.
+static int place(uint32_t b) {
+    const struct key *mine[BOOK_COUNT * 8];
+    uint32_t at[BOOK_COUNT * 8];
+    int n = 0;
+
+    for (int i = 0; i < nkeys; ++i)
+        if (bucket_of(&keys[i]) == b) mine[n++] = &keys[i];
+    if (n == 0) return 0;
+    for (uint32_t d = 1; d <= UINT16_MAX; ++d) {
+        int i;
+        for (i = 0; i < n; ++i) {
+            at[i] = book_hash(d, mine[i]->s, strlen(mine[i]->s)) & (SLOTS - 1);
+            if (slots[at[i]]) break;
+            slots[at[i]] = mine[i];
+        }
+        if (i == n) {
+            disp[b] = (uint16_t)d;
+            return 0;
+        }
+        while (i-- > 0) slots[at[i]] = NULL;
+    }
+    return -1;
+}
+
+int main(void) {
+    int size[BUCKETS] = {0};
+    uint32_t order[BUCKETS];
+
+    for (int b = 1; b <= BOOK_COUNT; ++b) {
+        for (int i = 0; i < 8 && aliases[b][i]; ++i) {
+            for (int j = 0; j < nkeys; ++j) {
+                if (strcmp(keys[j].s, aliases[b][i]) == 0) {
+                    fprintf(stderr, "mkbookhash: \"%s\" names books %d and %d\n",
+                            aliases[b][i], keys[j].book, b);
+                    return 1;
+                }
+            }
+            if (strlen(aliases[b][i]) > KEY_MAX) {
+                fprintf(stderr, "mkbookhash: \"%s\" is too long\n", aliases[b][i]);
+                return 1;
+            }
+            keys[nkeys++] = (struct key){aliases[b][i], b};
+        }
+    }
+
+    // Fullest buckets first, while most slots are still free.
+    for (int i = 0; i < nkeys; ++i) size[bucket_of(&keys[i])]++;
+    for (uint32_t b = 0; b < BUCKETS; ++b) order[b] = b;
+    for (int i = 1; i < BUCKETS; ++i)
+        for (int j = i; j > 0 && size[order[j]] > size[order[j - 1]]; --j) {
+            uint32_t t = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = t;
+        }
+    for (int i = 0; i < BUCKETS; ++i) {
+        if (place(order[i]) != 0) {
+            fprintf(stderr, "mkbookhash: no displacement for bucket %u\n", order[i]);
+            return 1;
+        }
+    }
+
+    printf("// Generated by tools/mkbookhash.c from its alias table; do not edit.\n"
+           "// %d keys. A key's slot is book_hash(disp, key) & (BOOK_HASH_SLOTS - 1),\n"
+           "// where disp is book_hash_disp[book_hash(0, key) & (BOOK_HASH_BUCKETS - 1)].\n"
+           "#define BOOK_HASH_BUCKETS %d\n"
+           "#define BOOK_HASH_SLOTS %d\n\n"
+           "static const uint16_t book_hash_disp[BOOK_HASH_BUCKETS] = {",
+           nkeys, BUCKETS, SLOTS);
+    for (int b = 0; b < BUCKETS; ++b)
+        printf("%s%u,", b % 10 ? " " : "\n    ", disp[b]);
+    printf("\n};\n\n"
+           "static const struct {\n"
+           "    char key[%d];\n"
+           "    uint8_t book;\n"
+           "} book_hash_slots[BOOK_HASH_SLOTS] = {\n", KEY_MAX + 1);
+    for (int s = 0; s < SLOTS; ++s)
+        if (slots[s]) printf("    [%d] = {\"%s\", %d},\n", s, slots[s]->s, slots[s]->book);
+    printf("};\n");
+    return 0;
+}
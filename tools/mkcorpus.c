@@ -0,0 +1,20 @@
+// Compiles the kjv table of a SQLite database into the binary corpus
+// format that the server maps at startup.
+//
+//   mkcorpus [db.db] [kjv.corpus]
+#include "corpus.h"
+#include <stdio.h>
+
+int main(int argc, char *argv[]) {
+    const char *in = argc > 1 ? argv[1] : "db.db";
+    const char *out = argc > 2 ? argv[2] : "kjv.corpus";
+
+    if (corpus_load_sqlite(in) != 0) return 1;
+    const struct corpus *cp = corpus_get();
+    if (corpus_write(cp, out) != 0) return 1;
+    printf("%s: %u books, %u chapters, %u verses, digest %016llx\n", out,
+           cp->nbooks, cp->nchapters, cp->nverses,
+           (unsigned long long)cp->digest);
+    corpus_free();
+    return 0;
+}
@@ -0,0 +1,77 @@
+// Times dispatch_find against the linear mg_match walk it replaced, for
+// growing route tables. Half the routes are literal and half take a
+// "{name}" segment, which the linear walk spells as '*'. Lookups cycle
+// through paths that hit every route, plus one that misses.
+//
+//   routebench
+#include "dispatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define LOOKUPS 2000000
+#define MAX_ROUTES 1000
+
+static char patterns[MAX_ROUTES][48], globs[MAX_ROUTES][48], paths[MAX_ROUTES + 1][48];
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long linear(size_t n, struct mg_str path) {
+    for (size_t i = 0; i < n; ++i)
+        if (mg_match(path, mg_str(globs[i]), NULL)) return (long)i;
+    return -1;
+}
+
+int main(void) {
+    static const size_t sizes[] = {10, 30, 100, 300, 1000};
+    static struct dispatch_route routes[MAX_ROUTES];
+    struct mg_str params[DISPATCH_MAX_PARAMS];
+
+    printf("%7s %14s %14s\n", "routes", "trie ns/op", "linear ns/op");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        size_t n = sizes[s];
+        for (size_t i = 0; i < n; ++i) {
+            if (i % 2) {
+                snprintf(patterns[i], sizeof(patterns[i]), "/kjv/r%zu/{id}", i);
+                snprintf(globs[i], sizeof(globs[i]), "/kjv/r%zu/*", i);
+                snprintf(paths[i], sizeof(paths[i]), "/kjv/r%zu/%zu", i, i * 7);
+            } else {
+                snprintf(patterns[i], sizeof(patterns[i]), "/kjv/r%zu", i);
+                snprintf(globs[i], sizeof(globs[i]), "/kjv/r%zu", i);
+                snprintf(paths[i], sizeof(paths[i]), "/kjv/r%zu", i);
+            }
+            routes[i] = (struct dispatch_route){NULL, patterns[i]};
+        }
+        snprintf(paths[n], sizeof(paths[n]), "/kjv/missing");
+
+        struct dispatch *d = dispatch_new(routes, n);
+        if (!d) return 1;
+        // Both sides must agree before they are timed.
+        for (size_t i = 0; i <= n; ++i) {
+            long a = dispatch_find(d, mg_str("GET"), mg_str(paths[i]), params);
+            long b = linear(n, mg_str(paths[i]));
+            if (a != b && !(a == DISPATCH_NOT_FOUND && b == -1)) {
+                fprintf(stderr, "routebench: %s: %ld != %ld\n", paths[i], a, b);
+                return 1;
+            }
+        }
+
+        long sink = 0;
+        double t0 = now();
+        for (size_t k = 0; k < LOOKUPS; ++k)
+            sink += dispatch_find(d, mg_str("GET"), mg_str(paths[k % (n + 1)]), params);
+        double t1 = now();
+        size_t lin = LOOKUPS / n * 10; // the linear walk is slow; fewer rounds
+        for (size_t k = 0; k < lin; ++k) sink += linear(n, mg_str(paths[k % (n + 1)]));
+        double t2 = now();
+        printf("%7zu %14.1f %14.1f\n", n, (t1 - t0) * 1e9 / LOOKUPS,
+               (t2 - t1) * 1e9 / (double)lin);
+        if (sink == 42) printf("\n");
+        dispatch_free(d);
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Times the scan engines against a naive memmem loop over every verse.
+// The naive loop runs on a copy of the text folded to lower case ahead of
+// time, so both sides find the same verses.
+//
+//   scanbench [corpus or database] [needle ...]
+//
+// Without a path it reads kjv.corpus, or db.db if there is none.
+#define _GNU_SOURCE
+#include "corpus.h"
+#include "scan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ROUNDS 20
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t naive(const struct corpus *cp, const char *folded, const char *needle,
+                      size_t n, uint32_t *out) {
+    uint32_t count = 0;
+    for (uint32_t v = 0; v < cp->nverses; ++v) {
+        size_t len = cp->text_offset[v + 1] - cp->text_offset[v] - 1;
+        if (memmem(folded + cp->text_offset[v], len, needle, n)) out[count++] = v;
+    }
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    static const char *defaults[] = {"the", "lord", "begat", "thee", "Jerusalem", "x"};
+    static const char *engines[] = {"avx2", "sse2", "scalar"};
+    const char **needles = argc > 2 ? (const char **)argv + 2 : defaults;
+    int nneedles = argc > 2 ? argc - 2 : (int)(sizeof(defaults) / sizeof(defaults[0]));
+
+    const char *map = argc > 1 ? argv[1] : "kjv.corpus", *db = argc > 1 ? argv[1] : "db.db";
+    if (corpus_map(map) != 0 && corpus_load_sqlite(db) != 0) return 1;
+    const struct corpus *cp = corpus_get();
+    size_t size = cp->text_offset[cp->nverses];
+    char *folded = malloc(size);
+    uint32_t *want = malloc(((size_t)cp->nverses + 1) * sizeof(*want));
+    uint32_t *got = malloc(((size_t)cp->nverses + 1) * sizeof(*got));
+    if (!folded || !want || !got) return 1;
+    for (size_t i = 0; i < size; ++i)
+        folded[i] = (char)(cp->text[i] >= 'A' && cp->text[i] <= 'Z' ? cp->text[i] + 32 : cp->text[i]);
+    printf("%u verses, %zu bytes of text, %d rounds\n", cp->nverses, size, ROUNDS);
+    printf("%-12s %-8s %8s %10s %8s\n", "needle", "engine", "verses", "MB/s", "speedup");
+
+    for (int k = 0; k < nneedles; ++k) {
+        size_t n = strlen(needles[k]);
+        char needle[256];
+        if (n == 0 || n >= sizeof(needle)) continue;
+        for (size_t i = 0; i <= n; ++i)
+            needle[i] = (char)(needles[k][i] >= 'A' && needles[k][i] <= 'Z' ? needles[k][i] + 32
+                                                                             : needles[k][i]);
+        uint32_t count = 0;
+        double t = now();
+        for (int r = 0; r < ROUNDS; ++r) count = naive(cp, folded, needle, n, want);
+        double base = now() - t;
+        printf("%-12s %-8s %8u %10.0f %8s\n", needles[k], "memmem", count,
+               size * (double)ROUNDS / base / 1e6, "1.00x");
+
+        for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); ++e) {
+            if (scan_set_engine(engines[e]) != 0) continue;
+            uint32_t c = 0;
+            t = now();
+            for (int r = 0; r < ROUNDS; ++r)
+                c = scan_verses(cp, 0, cp->nverses, needles[k], n, got);
+            double dt = now() - t;
+            printf("%-12s %-8s %8u %10.0f %7.2fx%s\n", needles[k], engines[e], c,
+                   size * (double)ROUNDS / dt / 1e6, base / dt,
+                   c == count && memcmp(got, want, c * sizeof(*got)) == 0 ? "" : "  MISMATCH");
+        }
+    }
+    free(folded);
+    free(want);
+    free(got);
+    corpus_free();
+    return 0;
+}
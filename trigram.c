@@ -0,0 +1,394 @@
+#include "trigram.h"
+#include "scan.h"
+#include "shard.h"
+#include "varint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct gram {
+    uint32_t key;    // the three folded bytes, first in the high bits
+    uint32_t df;     // verses containing the trigram
+    uint32_t offset; // of the posting list in postings
+};
+
+static struct {
+    // Sorted by key. A sentinel at grams[ngrams] holds the end of
+    // postings, so list i always ends where list i + 1 starts.
+    struct gram *grams;
+    uint32_t ngrams;
+    uint8_t *postings;
+    size_t postings_len, npostings;
+    const struct corpus *cp;
+    bool ready;
+} tg;
+
+static unsigned char fold(unsigned char ch) {
+    return ch >= 'A' && ch <= 'Z' ? ch + 32 : ch;
+}
+
+static bool is_word_byte(unsigned char ch) {
+    return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') ||
+           (ch >= 'A' && ch <= 'Z') || ch >= 0x80;
+}
+
+static uint32_t gram_key(const char *s) {
+    return (uint32_t)fold((unsigned char)s[0]) << 16 |
+           (uint32_t)fold((unsigned char)s[1]) << 8 | fold((unsigned char)s[2]);
+}
+
+static int by_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+
+// Writes the distinct trigram keys of text, sorted, to *keys. Returns
+// their number, or -1 on allocation failure.
+static long verse_grams(const char *text, size_t len, uint32_t **keys, size_t *cap) {
+    size_t n = 0;
+    if (len < 3) return 0;
+    if (len - 2 > *cap) {
+        uint32_t *p = realloc(*keys, (len - 2) * sizeof(*p));
+        if (!p) return -1;
+        *keys = p;
+        *cap = len - 2;
+    }
+    for (size_t i = 0; i + 2 < len; ++i) (*keys)[i] = gram_key(text + i);
+    qsort(*keys, len - 2, sizeof(**keys), by_u32);
+    for (size_t i = 0; i < len - 2; ++i)
+        if (n == 0 || (*keys)[i] != (*keys)[n - 1]) (*keys)[n++] = (*keys)[i];
+    return (long)n;
+}
+
+static const struct gram *gram_find(uint32_t key) {
+    uint32_t lo = 0, hi = tg.ngrams;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (tg.grams[mid].key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < tg.ngrams && tg.grams[lo].key == key ? &tg.grams[lo] : NULL;
+}
+
+// Per-trigram state while building: the last verse seen, as ordinal + 1
+// so that 0 means none, and the encoded size, later the write position.
+struct build {
+    uint32_t key, last;
+    size_t bytes;
+};
+
+static int by_key(const void *a, const void *b) {
+    return by_u32(&((const struct build *)a)->key, &((const struct build *)b)->key);
+}
+
+void trigram_free(void) {
+    free(tg.grams);
+    free(tg.postings);
+    memset(&tg, 0, sizeof(tg));
+}
+
+// Open-addressed map from trigram key to build index + 1, 0 when empty.
+struct slots {
+    uint32_t *slot;
+    unsigned bits;
+};
+
+static uint32_t *slot_of(const struct slots *s, const struct build *bt, uint32_t key) {
+    uint32_t h = (key * 0x9e3779b1u) >> (32 - s->bits), mask = (1u << s->bits) - 1;
+    while (s->slot[h] != 0 && bt[s->slot[h] - 1].key != key) h = (h + 1) & mask;
+    return &s->slot[h];
+}
+
+// Doubles the table, keeping it at most half full. Returns 0 or -1.
+static int slots_grow(struct slots *s, const struct build *bt, uint32_t nbt) {
+    struct slots ns = {calloc((size_t)1 << (s->bits + 1), sizeof(*ns.slot)), s->bits + 1};
+    if (!ns.slot) return -1;
+    for (uint32_t i = 0; i < nbt; ++i) *slot_of(&ns, bt, bt[i].key) = i + 1;
+    free(s->slot);
+    *s = ns;
+    return 0;
+}
+
+int trigram_build(const struct corpus *cp) {
+    struct slots slots = {NULL, 16};
+    struct build *bt = NULL;
+    uint32_t nbt = 0, cap = 0;
+    uint32_t *keys = NULL;
+    size_t keys_cap = 0, len;
+    long n;
+
+    trigram_free();
+    if ((slots.slot = calloc((size_t)1 << slots.bits, sizeof(*slots.slot))) == NULL)
+        goto oom;
+
+    // First pass: find the trigrams and size their lists.
+    for (uint32_t v = 0; v < cp->nverses; ++v) {
+        const char *text = corpus_text(cp, v, &len);
+        if ((n = verse_grams(text, len, &keys, &keys_cap)) < 0) goto oom;
+        for (long i = 0; i < n; ++i) {
+            uint32_t *slot = slot_of(&slots, bt, keys[i]);
+            if (*slot == 0) {
+                if (nbt == cap) {
+                    uint32_t c = cap ? cap * 2 : 4096;
+                    struct build *p = realloc(bt, c * sizeof(*p));
+                    if (!p) goto oom;
+                    bt = p;
+                    cap = c;
+                }
+                bt[nbt] = (struct build){keys[i], 0, 0};
+                *slot = ++nbt;
+                if (nbt * 2 > 1u << slots.bits) {
+                    if (slots_grow(&slots, bt, nbt) != 0) goto oom;
+                    slot = slot_of(&slots, bt, keys[i]);
+                }
+            }
+            struct build *b = &bt[*slot - 1];
+            b->bytes += varint_len(v - (b->last ? b->last - 1 : 0));
+            b->last = v + 1;
+        }
+    }
+    free(slots.slot);
+    slots.slot = NULL;
+
+    if ((tg.grams = malloc((nbt + 1) * sizeof(*tg.grams))) == NULL) goto oom;
+    qsort(bt, nbt, sizeof(*bt), by_key);
+    for (uint32_t i = 0; i < nbt; ++i) {
+        tg.grams[i] = (struct gram){bt[i].key, 0, (uint32_t)tg.postings_len};
+        tg.postings_len += bt[i].bytes;
+        bt[i].bytes = tg.grams[i].offset;
+        bt[i].last = 0;
+    }
+    tg.ngrams = nbt;
+    if (tg.postings_len > UINT32_MAX ||
+        (tg.postings = malloc(tg.postings_len ? tg.postings_len : 1)) == NULL)
+        goto oom;
+
+    // Second pass: encode. bt is in key order now, like grams.
+    for (uint32_t v = 0; v < cp->nverses; ++v) {
+        const char *text = corpus_text(cp, v, &len);
+        if ((n = verse_grams(text, len, &keys, &keys_cap)) < 0) goto oom;
+        for (long i = 0; i < n; ++i) {
+            uint32_t g = (uint32_t)(gram_find(keys[i]) - tg.grams);
+            struct build *b = &bt[g];
+            b->bytes = (size_t)(varint_put(tg.postings + b->bytes,
+                                           v - (b->last ? b->last - 1 : 0)) - tg.postings);
+            b->last = v + 1;
+            tg.grams[g].df++;
+        }
+    }
+    tg.grams[nbt] = (struct gram){UINT32_MAX, 0, (uint32_t)tg.postings_len};
+    for (uint32_t i = 0; i < nbt; ++i) tg.npostings += tg.grams[i].df;
+    tg.cp = cp;
+    tg.ready = true;
+    free(keys);
+    free(bt);
+    return 0;
+
+oom:
+    fprintf(stderr, "trigram: out of memory building the index\n");
+    free(slots.slot);
+    free(keys);
+    free(bt);
+    trigram_free();
+    return -1;
+}
+
+bool trigram_ready(void) {
+    return tg.ready;
+}
+
+// Returns true if the folded pattern p, of length n, occurs in text.
+static bool has_substring(const char *text, size_t len, const char *p, size_t n) {
+    for (size_t i = 0; i + n <= len; ++i) {
+        size_t j = 0;
+        while (j < n && fold((unsigned char)text[i + j]) == (unsigned char)p[j]) j++;
+        if (j == n) return true;
+    }
+    return false;
+}
+
+// Returns true if the word w, of length n, matches the folded glob p.
+static bool glob_match(const char *w, size_t n, const char *p) {
+    const char *star = NULL;
+    size_t i = 0, mark = 0;
+    while (i < n) {
+        if (*p == '*') {
+            star = p++;
+            mark = i;
+        } else if (*p != '\0' && (unsigned char)*p == fold((unsigned char)w[i])) {
+            p++;
+            i++;
+        } else if (star) {
+            p = star + 1;
+            i = ++mark;
+        } else {
+            return false;
+        }
+    }
+    while (*p == '*') p++;
+    return *p == '\0';
+}
+
+static bool has_word(const char *text, size_t len, const char *p) {
+    for (size_t i = 0; i < len;) {
+        while (i < len && !is_word_byte((unsigned char)text[i])) i++;
+        size_t start = i;
+        while (i < len && is_word_byte((unsigned char)text[i])) i++;
+        if (i > start && glob_match(text + start, i - start, p)) return true;
+    }
+    return false;
+}
+
+// Stores the verses on all the lists of grams, rarest first, in cand and
+// returns how many.
+static uint32_t intersect(const struct gram **grams, size_t ngrams, uint32_t *cand) {
+    const uint8_t *p = tg.postings + grams[0]->offset;
+    uint32_t ncand = 0;
+    for (uint32_t v = 0; ncand < grams[0]->df; ++ncand) cand[ncand] = v += varint_get(&p);
+    for (size_t i = 1; i < ngrams && ncand > 0; ++i) {
+        uint32_t v = 0, left = grams[i]->df, kept = 0;
+        p = tg.postings + grams[i]->offset;
+        for (uint32_t c = 0; c < ncand && left > 0; left--) {
+            v += varint_get(&p);
+            while (c < ncand && cand[c] < v) c++;
+            if (c < ncand && cand[c] == v) cand[kept++] = cand[c++];
+        }
+        ncand = kept;
+    }
+    return ncand;
+}
+
+static uint32_t lower_bound(const uint32_t *a, uint32_t n, uint32_t v) {
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (a[mid] < v) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// A pattern split into shards. Shard i confirms its own candidates, or
+// first scans its verses for them, and keeps the matches in place as
+// cand[base[i], base[i] + count[i]).
+struct find_query {
+    const char *pat;
+    size_t len, nstars;
+    const char *lit; // without a trigram, the literal run to scan for
+    size_t nlit;
+    uint32_t *cand, ncand;
+    uint32_t *base, *count;
+};
+
+static void find_shard(void *arg, uint32_t shard, uint32_t first, uint32_t end) {
+    struct find_query *q = arg;
+    uint32_t lo, hi, kept;
+    if (q->lit) {
+        // cand has room for every verse, so each shard scans into its own.
+        lo = first;
+        hi = first + scan_verses(tg.cp, first, end, q->lit, q->nlit, q->cand + first);
+    } else {
+        lo = lower_bound(q->cand, q->ncand, first);
+        hi = lower_bound(q->cand, q->ncand, end);
+    }
+    // Without wildcards the scan already decides the match.
+    kept = q->lit && q->nstars == 0 ? hi : lo;
+    for (uint32_t i = kept; i < hi; ++i) {
+        size_t tl;
+        const char *text = corpus_text(tg.cp, q->cand[i], &tl);
+        if (q->nstars ? has_word(text, tl, q->pat) : has_substring(text, tl, q->pat, q->len))
+            q->cand[kept++] = q->cand[i];
+    }
+    q->base[shard] = lo;
+    q->count[shard] = kept - lo;
+}
+
+long trigram_search(const char *pattern, uint32_t skip, uint32_t *out, uint32_t max,
+                    bool *truncated, char *err, size_t errlen) {
+    char pat[TRIGRAM_MAX_PATTERN + 1];
+    const struct gram *grams[TRIGRAM_MAX_PATTERN];
+    size_t len = strlen(pattern), ngrams = 0, nstars = 0, run = 0, lit = 0, nlit = 0;
+    uint32_t nshards = shard_count();
+    struct find_query q = {.pat = pat, .len = len};
+    long total = 0;
+
+    *truncated = false;
+    if (!tg.ready) {
+        snprintf(err, errlen, "trigram index not loaded");
+        return -1;
+    }
+    if (len > TRIGRAM_MAX_PATTERN) {
+        snprintf(err, errlen, "pattern is longer than %d bytes", TRIGRAM_MAX_PATTERN);
+        return -1;
+    }
+    for (size_t i = 0; i <= len; ++i) pat[i] = (char)fold((unsigned char)pattern[i]);
+
+    // Collect the distinct trigrams of the literal runs between wildcards.
+    for (size_t i = 0; i < len; ++i) {
+        if (pat[i] == '*') {
+            if (++nstars > TRIGRAM_MAX_WILDCARDS) {
+                snprintf(err, errlen, "pattern has more than %d wildcards",
+                         TRIGRAM_MAX_WILDCARDS);
+                return -1;
+            }
+            run = 0;
+            continue;
+        }
+        if (++run > nlit) lit = i + 1 - run, nlit = run;
+        if (run < 3) continue;
+        const struct gram *g = gram_find(gram_key(pat + i - 2));
+        size_t j;
+        if (!g) return 0; // no verse has it
+        for (j = 0; j < ngrams && grams[j] != g; ++j) {}
+        if (j == ngrams) grams[ngrams++] = g;
+    }
+    if (nlit == 0) {
+        snprintf(err, errlen, "pattern needs a character besides '*'");
+        return -1;
+    }
+    q.nstars = nstars;
+    q.base = malloc(nshards * sizeof(*q.base));
+    q.count = calloc(nshards, sizeof(*q.count));
+    if (ngrams > 0) {
+        // Intersect, rarest list first.
+        for (size_t i = 1; i < ngrams; ++i) {
+            const struct gram *g = grams[i];
+            size_t j = i;
+            for (; j > 0 && grams[j - 1]->df > g->df; --j) grams[j] = grams[j - 1];
+            grams[j] = g;
+        }
+        if ((q.cand = malloc(grams[0]->df * sizeof(*q.cand))) != NULL)
+            q.ncand = intersect(grams, ngrams, q.cand);
+    } else {
+        // Nothing to look up: scan the text for the longest literal run.
+        q.cand = malloc(((size_t)tg.cp->nverses + 1) * sizeof(*q.cand));
+        q.lit = pat + lit;
+        q.nlit = nlit;
+        q.ncand = tg.cp->nverses; // for shard_run, every verse is a candidate
+    }
+    if (!q.cand || !q.base || !q.count) {
+        snprintf(err, errlen, "out of memory");
+        total = -1;
+        goto done;
+    }
+
+    if (q.ncand > 0) *truncated = !shard_run(find_shard, &q, q.ncand, SHARD_BUDGET_NS);
+    for (uint32_t s = 0; s < nshards; ++s) {
+        for (uint32_t i = 0; i < q.count[s]; ++i, ++total) {
+            if ((uint64_t)total >= skip && (uint64_t)total < (uint64_t)skip + max)
+                out[total - skip] = q.cand[q.base[s] + i];
+        }
+    }
+done:
+    free(q.cand);
+    free(q.base);
+    free(q.count);
+    return total;
+}
+
+void trigram_get_stats(struct trigram_stats *out) {
+    out->grams = tg.ngrams;
+    out->postings = tg.npostings;
+    out->bytes = tg.postings_len + (tg.ready ? (tg.ngrams + 1) * sizeof(*tg.grams) : 0);
+}
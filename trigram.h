@@ -0,0 +1,43 @@
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "corpus.h"
+
+// Trigram index over the verse text, folded to ASCII lower case. Every
+// three-byte sequence of a verse maps to a delta- and varint-encoded list
+// of the ordinals of the verses containing it. A pattern's candidates are
+// the verses holding all of its trigrams; each is then confirmed against
+// the text. A pattern too short to have a trigram falls back to a scan of
+// the whole text (scan.h). Confirmation and scans run on the shards of
+// shard.h. Read-only once built and safe to query from any thread.
+#define TRIGRAM_MAX_PATTERN 64
+#define TRIGRAM_MAX_WILDCARDS 4
+
+struct trigram_stats {
+    size_t grams;    // distinct trigrams
+    size_t postings; // (trigram, verse) pairs
+    size_t bytes;    // encoded posting lists and the trigram table
+};
+
+// Builds the index over cp, replacing any previous one. Returns 0 on
+// success, -1 on allocation failure.
+int trigram_build(const struct corpus *cp);
+void trigram_free(void);
+bool trigram_ready(void);
+
+// Finds the verses matching pattern, ignoring ASCII case. Without '*' the
+// pattern matches anywhere in the text. With '*' it must match a whole
+// word, each '*' standing for any run of letters and digits: "begat*",
+// "*eth". Stores the ordinals of matches [skip, skip + max), in corpus
+// order, in out and returns the total number of matches. If the query used
+// up SHARD_BUDGET_NS, the total only counts the shards searched and
+// *truncated is set. On a pattern of wildcards only, with too many
+// wildcards, or on allocation failure returns -1 and writes a one-line
+// reason to err.
+long trigram_search(const char *pattern, uint32_t skip, uint32_t *out, uint32_t max,
+                    bool *truncated, char *err, size_t errlen);
+
+void trigram_get_stats(struct trigram_stats *out);
+#endif // TRIGRAM_H
@@ -0,0 +1,38 @@
+#ifndef VARINT_H
+#define VARINT_H
+#include <stddef.h>
+#include <stdint.h>
+
+// LEB128 varints for the posting lists of the search and trigram indexes:
+// seven bits per byte, least significant first, the high bit set on every
+// byte but the last.
+
+static inline size_t varint_len(uint32_t v) {
+    size_t n = 1;
+    while (v >= 0x80) v >>= 7, n++;
+    return n;
+}
+
+// Writes v at p and returns the byte after it.
+static inline uint8_t *varint_put(uint8_t *p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+// Reads the varint at *pp and advances *pp past it.
+static inline uint32_t varint_get(const uint8_t **pp) {
+    const uint8_t *p = *pp;
+    uint32_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (b < 0x80) break;
+    }
+    *pp = p;
+    return v;
+}
+#endif // VARINT_H